@@ -0,0 +1,347 @@
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include "../constellationHandler.h"
+#include "../linkAddressAllocator.h"
+#include "../SRFMath.h"
+#include "../tleHandler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <tuple>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Benchmark");
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct MicroResult
+{
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+} MicroResult;
+
+typedef struct MacroResult
+{
+    uint32_t requestedSatCount;
+    uint32_t satCount;
+    double setupSeconds;
+    double firstTickMs;             // the first update establishes every link from scratch
+    std::vector<double> tickMs;     // the updates after the first one
+} MacroResult;
+
+/**
+ * Reaches into Constellation for the parts the benchmark times directly.
+ */
+class ConstellationBenchmark
+{
+    public:
+        static void initializeSatIntraLinks(Constellation& constellation) {
+            constellation.initializeSatIntraLinks();
+        }
+
+        static void propagate(Constellation& constellation) {
+            constellation.propagateConstellationState();
+        }
+
+        static void updateConstellation(Constellation& constellation) {
+            constellation.updateConstellation();
+        }
+
+        static uint32_t satelliteCount(const Constellation& constellation) {
+            return constellation.satelliteCount;
+        }
+
+        static const ConstellationState& state(const Constellation& constellation) {
+            return constellation.state;
+        }
+
+        static bool gsIsLinkValid(const Constellation& constellation, Vector gsPos, Vector satPos) {
+            return constellation.gsIsLinkValid(gsPos, satPos);
+        }
+
+        static bool satIsLinkValid(const Constellation& constellation, Vector satPos, Vector satVel, int netDeviceIndex,
+                                   Vector connSatPos, Vector connSatVel, int connNetDeviceIndex) {
+            return constellation.satIsLinkValid(satPos, satVel, netDeviceIndex, connSatPos, connSatVel, connNetDeviceIndex);
+        }
+};
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Time 'iterations' calls of 'body', which gets the iteration number
+template <typename F>
+static MicroResult runMicro(const std::string& name, uint64_t iterations, F&& body) {
+    Clock::time_point start = Clock::now();
+    for (uint64_t n = 0; n < iterations; n++) {
+        body(n);
+    }
+    MicroResult result = {name, iterations, 1e9 * secondsSince(start) / iterations};
+    NS_LOG_UNCOND("[+] " << name << ": " << result.nsPerOp << " ns/op over " << iterations << " iterations");
+    return result;
+}
+
+/**
+ * Write an orbit file covering every satellite in the TLE data, as the orbit file that comes with it only covers a few
+ * hundred. Satellites are grouped into planes by inclination, mean motion (so by shell) and RAAN, and ordered by their
+ * argument of latitude within each plane. This only approximates the real planes, which is good enough to have links
+ * along the orbits at every constellation size.
+ */
+static void writePlaneOrbits(const std::string& tleDataPath, const std::string& orbitsPath, double planeWidthDegrees) {
+    TLECatalog catalog(tleDataPath);
+
+    typedef std::tuple<int, int, int> PlaneKey;
+    std::map<PlaneKey, std::vector<std::pair<double, std::string_view>>> planes;
+    for (const TLERecord& record : catalog.records) {
+        // Only the first record of a name can be found, and names must be unique
+        if (catalog.find(record.name) != &record) {
+            continue;
+        }
+        const TLEElements& elements = record.elements;
+        PlaneKey key(int(std::lround(elements.inclination)), int(std::lround(elements.meanMotion * 2)),
+                     int(std::floor(elements.raan / planeWidthDegrees)));
+        double argumentOfLatitude = std::fmod(elements.argOfPerigee + elements.meanAnomaly, 360.0);
+        planes[key].emplace_back(argumentOfLatitude, record.name);
+    }
+
+    std::ofstream file(orbitsPath, std::ios::trunc);
+    NS_ABORT_MSG_IF(!file.is_open(), "Failed to open " << orbitsPath);
+    for (auto& [key, satellites] : planes) {
+        std::sort(satellites.begin(), satellites.end());
+        file << "PLANE-" << std::get<0>(key) << "-" << std::get<1>(key) << "-" << std::get<2>(key) << "\n";
+        for (size_t n = 0; n < satellites.size(); n++) {
+            file << (n == 0 ? "" : ",") << satellites[n].second;
+        }
+        file << "\n";
+    }
+    NS_LOG_UNCOND("[+] Wrote " << planes.size() << " planes to " << orbitsPath);
+}
+
+static std::vector<uint32_t> parseCounts(const std::string& counts) {
+    std::vector<uint32_t> values;
+    std::stringstream stream(counts);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        values.push_back(std::stoul(value));
+    }
+    return values;
+}
+
+static Constellation* createConstellation(uint32_t satCount, const std::string& tleDataPath, const std::string& orbitsPath,
+                                          const std::vector<GeoCoordinate>& groundStations, uint32_t threads, const std::string& routing) {
+    Constellation* constellation = new Constellation(satCount, tleDataPath, orbitsPath, groundStations.size(), groundStations,
+                                                     DataRate("100Mbps"), DataRate("100Mbps"), 0, 0, TimeValue(Seconds(2)), "");
+    constellation->setThreadCount(threads);
+    constellation->setRoutingMode(routing);
+    return constellation;
+}
+
+// Forget every node, channel and name, such that the next constellation starts from node 0 again
+static void resetSimulator() {
+    Simulator::Destroy();
+    Names::Clear();
+}
+
+static std::vector<MicroResult> runMicroBenchmarks(const std::string& tleDataPath, const std::string& orbitsPath,
+                                                   const std::vector<GeoCoordinate>& groundStations, uint32_t satCount, uint64_t iterations) {
+    std::vector<MicroResult> results;
+    volatile double sink = 0;
+
+    {
+        std::unique_ptr<Constellation> constellation(createConstellation(satCount, tleDataPath, orbitsPath, groundStations, 1, "global"));
+        ConstellationBenchmark::propagate(*constellation);
+        const ConstellationState& state = ConstellationBenchmark::state(*constellation);
+        uint32_t count = ConstellationBenchmark::satelliteCount(*constellation);
+
+        results.push_back(runMicro("getAngleFromSatPair", iterations, [&](uint64_t n) {
+            uint32_t a = n % count;
+            uint32_t b = (n * 7 + 1) % count;
+            std::pair<double, double> angles = getAngleFromSatPair(state.getPosition(a), state.getVelocity(a), state.getPosition(b), state.getVelocity(b));
+            sink = sink + angles.first;
+        }));
+
+        results.push_back(runMicro("satIsLinkValid", iterations, [&](uint64_t n) {
+            uint32_t a = n % count;
+            uint32_t b = (n * 7 + 1) % count;
+            sink = sink + ConstellationBenchmark::satIsLinkValid(*constellation, state.getPosition(a), state.getVelocity(a), 1 + n % 4,
+                                                                 state.getPosition(b), state.getVelocity(b), 1 + (n / 4) % 4);
+        }));
+
+        Vector gsPos = state.getGSPosition(0);
+        results.push_back(runMicro("gsIsLinkValid", iterations, [&](uint64_t n) {
+            sink = sink + ConstellationBenchmark::gsIsLinkValid(*constellation, gsPos, state.getPosition(n % count));
+        }));
+    }
+    resetSimulator();
+
+    // Parsing is far slower than the kernels above, so it gets fewer rounds
+    results.push_back(runMicro("ReadTLEFile", std::max<uint64_t>(1, iterations / 100000), [&](uint64_t) {
+        std::string age;
+        sink = sink + ReadTLEFile(tleDataPath, age).size();
+    }));
+
+    // Every round allocates 1024 links and releases them again, like link churn does over an update
+    LinkAddressAllocator allocator;
+    allocator.configure(Ipv4Address("2.0.0.0"), Ipv4Mask("/8"), Ipv4Mask("/24"));
+    std::vector<Ipv4Address> allocated(1024);
+    results.push_back(runMicro("LinkAddressAllocator", std::max<uint64_t>(1, iterations / 1024), [&](uint64_t) {
+        for (Ipv4Address& address : allocated) {
+            address = allocator.allocate().first;
+        }
+        for (const Ipv4Address& address : allocated) {
+            allocator.release(address);
+        }
+    }));
+    // Report the cost of one allocate() and release() pair
+    results.back().iterations *= allocated.size();
+    results.back().nsPerOp /= allocated.size();
+
+    return results;
+}
+
+static MacroResult runMacroBenchmark(uint32_t satCount, const std::string& tleDataPath, const std::string& orbitsPath,
+                                     const std::vector<GeoCoordinate>& groundStations, uint32_t threads, const std::string& routing,
+                                     uint32_t ticks, uint32_t updateInterval) {
+    MacroResult result;
+    result.requestedSatCount = satCount;
+
+    Clock::time_point setupStart = Clock::now();
+    std::unique_ptr<Constellation> constellation(createConstellation(satCount, tleDataPath, orbitsPath, groundStations, threads, routing));
+    ConstellationBenchmark::initializeSatIntraLinks(*constellation);
+    result.setupSeconds = secondsSince(setupStart);
+    result.satCount = ConstellationBenchmark::satelliteCount(*constellation);
+
+    // Run the updates as simulator events, such that the satellites move between them as in a real run
+    for (uint32_t tick = 0; tick < ticks; tick++) {
+        Simulator::Schedule(Seconds(tick * updateInterval), [&result, &constellation, tick]() {
+            Clock::time_point start = Clock::now();
+            ConstellationBenchmark::updateConstellation(*constellation);
+            double ms = 1e3 * secondsSince(start);
+            if (tick == 0) {
+                result.firstTickMs = ms;
+            } else {
+                result.tickMs.push_back(ms);
+            }
+        });
+    }
+    Simulator::Run();
+
+    double total = 0;
+    for (double ms : result.tickMs) {
+        total += ms;
+    }
+    NS_LOG_UNCOND("[+] " << result.satCount << " satellites: setup " << result.setupSeconds << " s, first update " << result.firstTickMs
+                  << " ms, " << (result.tickMs.empty() ? 0 : total / result.tickMs.size()) << " ms per update after that");
+
+    constellation.reset();
+    resetSimulator();
+    return result;
+}
+
+static void writeReport(const std::string& path, uint32_t seed, uint32_t threads, const std::string& routing, uint32_t updateInterval,
+                        const std::vector<MicroResult>& micro, const std::vector<MacroResult>& macro) {
+    std::ofstream report(path, std::ios::trunc);
+    NS_ABORT_MSG_IF(!report.is_open(), "Failed to open " << path);
+
+    report << "{\n";
+    report << "  \"timestamp\": " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() << ",\n";
+    report << "  \"seed\": " << seed << ",\n";
+    report << "  \"threads\": " << threads << ",\n";
+    report << "  \"routing\": \"" << routing << "\",\n";
+    report << "  \"updateInterval\": " << updateInterval << ",\n";
+
+    report << "  \"micro\": [";
+    for (size_t n = 0; n < micro.size(); n++) {
+        report << (n == 0 ? "\n" : ",\n") << "    {\"name\": \"" << micro[n].name << "\", \"iterations\": " << micro[n].iterations
+               << ", \"nsPerOp\": " << micro[n].nsPerOp << "}";
+    }
+    report << "\n  ],\n";
+
+    report << "  \"macro\": [";
+    for (size_t n = 0; n < macro.size(); n++) {
+        const MacroResult& result = macro[n];
+        double total = 0;
+        double min = result.tickMs.empty() ? 0 : result.tickMs[0];
+        double max = 0;
+        for (double ms : result.tickMs) {
+            total += ms;
+            min = std::min(min, ms);
+            max = std::max(max, ms);
+        }
+        report << (n == 0 ? "\n" : ",\n") << "    {\"requestedSatCount\": " << result.requestedSatCount << ", \"satCount\": " << result.satCount
+               << ", \"setupSeconds\": " << result.setupSeconds << ", \"firstTickMs\": " << result.firstTickMs
+               << ", \"ticks\": " << result.tickMs.size() << ", \"meanTickMs\": " << (result.tickMs.empty() ? 0 : total / result.tickMs.size())
+               << ", \"minTickMs\": " << min << ", \"maxTickMs\": " << max << ", \"tickMs\": [";
+        for (size_t tick = 0; tick < result.tickMs.size(); tick++) {
+            report << (tick == 0 ? "" : ", ") << result.tickMs[tick];
+        }
+        report << "]}";
+    }
+    report << "\n  ]\n";
+    report << "}\n";
+    NS_LOG_UNCOND("[+] Report written to " << path);
+}
+
+int main(int argc, char* argv[]) {
+    Time::SetResolution(Time::NS);
+
+    std::string tleDataPath = "scratch/P5-Satellite/resources/starlink_13-11-2024_tle_data.txt";
+    std::string tleOrbitsPath = "";
+    std::string satCounts = "100,500,1000,3000,6000";
+    uint32_t seed = 1;
+    uint32_t ticks = 5;
+    uint32_t updateInterval = 15;
+    uint32_t threads = 1;
+    std::string routing = "global";
+    uint64_t microIterations = 1000000;
+    uint32_t microSatCount = 1000;
+    std::string reportPath = "scratch/P5-Satellite/out/benchmark.json";
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("tledata", "TLE Data path", tleDataPath);
+    cmd.AddValue("tleorbits", "TLE Orbits path, empty to group all satellites in the TLE data into planes", tleOrbitsPath);
+    cmd.AddValue("satCounts", "Comma separated constellation sizes for the update benchmarks", satCounts);
+    cmd.AddValue("seed", "Seed of the random number generators", seed);
+    cmd.AddValue("ticks", "Updates per constellation size, including the first one", ticks);
+    cmd.AddValue("updateInterval", "Simulated seconds between updates", updateInterval);
+    cmd.AddValue("threads", "Amount of threads used for updating the constellation", threads);
+    cmd.AddValue("routing", "Routing: global, incremental or gs", routing);
+    cmd.AddValue("microIterations", "Iterations of the geometry micro benchmarks", microIterations);
+    cmd.AddValue("microSatCount", "Constellation size the geometry micro benchmarks sample satellites from", microSatCount);
+    cmd.AddValue("report", "Path of the JSON report", reportPath);
+    cmd.Parse(argc, argv);
+
+    RngSeedManager::SetSeed(seed);
+    RngSeedManager::SetRun(1);
+
+    if (tleOrbitsPath.empty()) {
+        tleOrbitsPath = "scratch/P5-Satellite/out/benchmark_orbits.txt";
+        writePlaneOrbits(tleDataPath, tleOrbitsPath, 5.0);
+    }
+
+    // Same ground stations as p5-satellite.cc
+    std::vector<GeoCoordinate> groundStations;
+    groundStations.emplace_back(GeoCoordinate(40.711394051407254, -74.01147005959824, 20));
+    groundStations.emplace_back(GeoCoordinate(25.217273781972715, 55.28287038973016, 20));
+
+    std::vector<MicroResult> micro = runMicroBenchmarks(tleDataPath, tleOrbitsPath, groundStations, microSatCount, microIterations);
+
+    std::vector<MacroResult> macro;
+    for (uint32_t satCount : parseCounts(satCounts)) {
+        // Every size starts from the same random state
+        RngSeedManager::SetSeed(seed);
+        macro.push_back(runMacroBenchmark(satCount, tleDataPath, tleOrbitsPath, groundStations, threads, routing, ticks, updateInterval));
+    }
+
+    writeReport(reportPath, seed, threads, routing, updateInterval, micro, macro);
+    return 0;
+}
@@ -0,0 +1,274 @@
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include "../constellationHandler.h"
+#include "../SRFMath.h"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <tuple>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Checks");
+
+/**
+ * Reaches into Constellation for the parts the checks compare against a reference.
+ */
+class ConstellationChecks
+{
+    public:
+        static void propagate(Constellation& constellation) {
+            constellation.propagateConstellationState();
+        }
+
+        static uint32_t satelliteCount(const Constellation& constellation) {
+            return constellation.satelliteCount;
+        }
+
+        static const ConstellationState& state(const Constellation& constellation) {
+            return constellation.state;
+        }
+
+        static const SRFBasisCache& srfBases(const Constellation& constellation) {
+            return constellation.srfBases;
+        }
+
+        static double maxSatToSatDistance(const Constellation& constellation) {
+            return constellation.maxSatToSatDistance * 1000;
+        }
+
+        static void initializeSatIntraLinks(Constellation& constellation) {
+            constellation.initializeSatIntraLinks();
+        }
+
+        // Establish the new links right away instead of after the link acquisition time, such that their link IDs give
+        // the order they were made in
+        static void updateSatelliteLinks(Constellation& constellation) {
+            constellation.firstTimeLinkEstablishing = true;
+            constellation.updateSatelliteLinks();
+        }
+
+        static bool satIsLinkValid(Constellation& constellation, uint32_t satIndex, int netDevIndex, uint32_t connSatIndex, int connNetDevIndex) {
+            return constellation.satIsLinkValid(satIndex, netDevIndex, connSatIndex, connNetDevIndex);
+        }
+
+        static bool isTerminalFree(const Constellation& constellation, uint32_t satIndex, int netDevIndex) {
+            return constellation.isTerminalFree(satIndex, netDevIndex);
+        }
+
+        static uint64_t terminalReleaseOrder(const Constellation& constellation, uint32_t satIndex, int netDevIndex) {
+            return constellation.terminalReleaseOrder[satIndex * Constellation::terminalsPerNode + netDevIndex];
+        }
+
+        // Peer, peer terminal and link ID on a terminal, NO_LINK as peer if it is free
+        static std::tuple<uint32_t, int, uint32_t> getLink(const Constellation& constellation, uint32_t satIndex, int netDevIndex) {
+            const Constellation::LinkState& link = constellation.getLinkState(satIndex, netDevIndex);
+            return {link.peer, link.peerTerminal, link.linkId};
+        }
+
+        static uint32_t nextLinkId(const Constellation& constellation) {
+            return constellation.nextLinkId;
+        }
+
+        static constexpr uint32_t NO_LINK = Constellation::NO_LINK;
+};
+
+// satIndex, netDevIndex, connSatIndex, connNetDevIndex
+typedef std::tuple<uint32_t, int, uint32_t, int> SatLink;
+
+/**
+ * Check getSectorsFromSatBatch() against getSectorFromAngle(getAngleFromSatPair()) for every pair of satellites in range of
+ * each other, the pairs the link scan evaluates. Returns the amount of pairs where the sectors differ.
+ */
+static uint64_t checkSectorBatch(const Constellation& constellation) {
+    const ConstellationState& state = ConstellationChecks::state(constellation);
+    const SRFBasisCache& bases = ConstellationChecks::srfBases(constellation);
+    uint32_t count = ConstellationChecks::satelliteCount(constellation);
+    double maxDistance = ConstellationChecks::maxSatToSatDistance(constellation);
+
+    uint64_t pairs = 0;
+    uint64_t mismatches = 0;
+    std::vector<uint32_t> neighbours;
+    std::vector<int> sectors, connSectors;
+    SectorBatchScratch scratch;
+    for (uint32_t satIndex = 0; satIndex < count; satIndex++) {
+        neighbours.clear();
+        for (uint32_t connSatIndex = 0; connSatIndex < count; connSatIndex++) {
+            if (connSatIndex != satIndex && state.getDistance(satIndex, connSatIndex) <= maxDistance) {
+                neighbours.push_back(connSatIndex);
+            }
+        }
+        sectors.resize(neighbours.size());
+        connSectors.resize(neighbours.size());
+        getSectorsFromSatBatch(satIndex, neighbours.data(), neighbours.size(), state.x.data(), state.y.data(), state.z.data(),
+                               bases, scratch, sectors.data(), connSectors.data());
+
+        for (size_t n = 0; n < neighbours.size(); n++) {
+            uint32_t connSatIndex = neighbours[n];
+            std::pair<double, double> angles = getAngleFromSatPair(state.getPosition(satIndex), state.getVelocity(satIndex),
+                                                                   state.getPosition(connSatIndex), state.getVelocity(connSatIndex));
+            int sector = getSectorFromAngle(angles.first);
+            int connSector = getSectorFromAngle(angles.second);
+            pairs++;
+            if (sectors[n] != sector || connSectors[n] != connSector) {
+                mismatches++;
+                NS_LOG_UNCOND("[!] Sectors of satellites " << satIndex << " and " << connSatIndex << ": batch " << sectors[n] << "/"
+                              << connSectors[n] << ", scalar " << sector << "/" << connSector);
+            }
+        }
+    }
+    NS_LOG_UNCOND("[+] <" << Simulator::Now().GetSeconds() << "s> getSectorsFromSatBatch() checked on " << pairs << " pairs of "
+                  << count << " satellites, " << mismatches << " differ from the scalar version");
+    return mismatches;
+}
+
+/**
+ * The inter satellite link update as the simulator originally did it, without the grid, the candidate lists and the batch
+ * kernel: break every invalid link, appending the freed netdevices to the free lists of both satellites, then let every
+ * satellite try its free netdevices in list order against all other satellites in ascending order. Returns the links it
+ * makes, in the order it makes them.
+ */
+static std::vector<SatLink> fullScanSatelliteLinks(Constellation& constellation) {
+    uint32_t count = ConstellationChecks::satelliteCount(constellation);
+
+    // The free netdevices of every satellite, in the order they were freed
+    std::vector<std::vector<int>> freeNetDevs(count);
+    for (uint32_t satIndex = 0; satIndex < count; satIndex++) {
+        for (int netDevIndex = 1; netDevIndex <= 4; netDevIndex++) {
+            if (ConstellationChecks::isTerminalFree(constellation, satIndex, netDevIndex)) {
+                freeNetDevs[satIndex].push_back(netDevIndex);
+            }
+        }
+        std::sort(freeNetDevs[satIndex].begin(), freeNetDevs[satIndex].end(), [&constellation, satIndex](int a, int b) {
+            return ConstellationChecks::terminalReleaseOrder(constellation, satIndex, a) < ConstellationChecks::terminalReleaseOrder(constellation, satIndex, b);
+        });
+    }
+
+    // Link maintenance
+    std::set<uint32_t> brokenLinks;
+    for (uint32_t satIndex = 0; satIndex < count; satIndex++) {
+        for (int netDevIndex = 1; netDevIndex <= 4; netDevIndex++) {
+            auto [connSatIndex, connNetDevIndex, linkId] = ConstellationChecks::getLink(constellation, satIndex, netDevIndex);
+            // Each link is seen from both of its satellites, but can only break once
+            if (connSatIndex == ConstellationChecks::NO_LINK || brokenLinks.count(linkId) != 0) {
+                continue;
+            }
+            if (!ConstellationChecks::satIsLinkValid(constellation, satIndex, netDevIndex, connSatIndex, connNetDevIndex)) {
+                brokenLinks.insert(linkId);
+                freeNetDevs[satIndex].push_back(netDevIndex);
+                freeNetDevs[connSatIndex].push_back(connNetDevIndex);
+            }
+        }
+    }
+
+    // Link establishment
+    std::vector<SatLink> links;
+    for (uint32_t satIndex = 0; satIndex < count; satIndex++) {
+        std::vector<int> linkedNetDevs;
+        for (int netDevIndex : freeNetDevs[satIndex]) {
+            bool connected = false;
+            for (uint32_t connSatIndex = 0; connSatIndex < count && !connected; connSatIndex++) {
+                if (connSatIndex == satIndex) {
+                    continue;
+                }
+                std::vector<int>& connNetDevs = freeNetDevs[connSatIndex];
+                for (size_t n = 0; n < connNetDevs.size(); n++) {
+                    if (ConstellationChecks::satIsLinkValid(constellation, satIndex, netDevIndex, connSatIndex, connNetDevs[n])) {
+                        links.emplace_back(satIndex, netDevIndex, connSatIndex, connNetDevs[n]);
+                        connNetDevs.erase(connNetDevs.begin() + n);
+                        connected = true;
+                        break;
+                    }
+                }
+            }
+            if (connected) {
+                linkedNetDevs.push_back(netDevIndex);
+            }
+        }
+        for (int netDevIndex : linkedNetDevs) {
+            freeNetDevs[satIndex].erase(std::find(freeNetDevs[satIndex].begin(), freeNetDevs[satIndex].end(), netDevIndex));
+        }
+    }
+    return links;
+}
+
+/**
+ * Check that updateSatelliteLinks() makes the same links, in the same order, as the original full scan. The order decides
+ * the link IDs and the subnets the address allocator gives out. Returns the amount of links that differ.
+ */
+static uint64_t checkSatelliteLinks(Constellation& constellation) {
+    std::vector<SatLink> expected = fullScanSatelliteLinks(constellation);
+
+    uint32_t firstLinkId = ConstellationChecks::nextLinkId(constellation);
+    ConstellationChecks::updateSatelliteLinks(constellation);
+    uint32_t count = ConstellationChecks::satelliteCount(constellation);
+
+    // The satellite that made a new link is the lower one, the other one was handed the link while scanning
+    std::vector<SatLink> made(ConstellationChecks::nextLinkId(constellation) - firstLinkId);
+    for (uint32_t satIndex = 0; satIndex < count; satIndex++) {
+        for (int netDevIndex = 1; netDevIndex <= 4; netDevIndex++) {
+            auto [connSatIndex, connNetDevIndex, linkId] = ConstellationChecks::getLink(constellation, satIndex, netDevIndex);
+            if (connSatIndex == ConstellationChecks::NO_LINK || linkId < firstLinkId || connSatIndex < satIndex) {
+                continue;
+            }
+            made[linkId - firstLinkId] = SatLink(satIndex, netDevIndex, connSatIndex, connNetDevIndex);
+        }
+    }
+
+    uint64_t mismatches = 0;
+    for (size_t n = 0; n < std::max(made.size(), expected.size()); n++) {
+        if (n >= made.size() || n >= expected.size() || made[n] != expected[n]) {
+            mismatches++;
+        }
+    }
+    NS_LOG_UNCOND("[+] <" << Simulator::Now().GetSeconds() << "s> updateSatelliteLinks() made " << made.size() << " links, the full scan "
+                  << expected.size() << ", " << mismatches << " differ in order or endpoints");
+    return mismatches;
+}
+
+
+int main(int argc, char* argv[]) {
+    Time::SetResolution(Time::NS);
+
+    std::string tleDataPath = "scratch/P5-Satellite/resources/starlink_13-11-2024_tle_data.txt";
+    std::string tleOrbitsPath = "scratch/P5-Satellite/resources/starlink_13-11-2024_orbits.txt";
+    uint32_t satCount = 0;
+    uint32_t snapshots = 4;
+    uint32_t snapshotInterval = 600;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("tledata", "TLE Data path", tleDataPath);
+    cmd.AddValue("tleorbits", "TLE Orbits path", tleOrbitsPath);
+    cmd.AddValue("satCount", "Amount of satellites to check, 0 for all", satCount);
+    cmd.AddValue("snapshots", "Amount of points in time the constellation is checked at", snapshots);
+    cmd.AddValue("snapshotInterval", "Simulated seconds between the points in time", snapshotInterval);
+    cmd.Parse(argc, argv);
+
+    std::vector<GeoCoordinate> groundStations;
+    groundStations.emplace_back(GeoCoordinate(40.711394051407254, -74.01147005959824, 20));
+    std::unique_ptr<Constellation> constellation(new Constellation(satCount, tleDataPath, tleOrbitsPath, groundStations.size(), groundStations,
+                                                                   DataRate("100Mbps"), DataRate("100Mbps"), 0, 0, TimeValue(Seconds(2)), ""));
+
+    uint64_t failures = 0;
+    for (uint32_t n = 0; n < snapshots; n++) {
+        Simulator::Schedule(Seconds(n * snapshotInterval), [&constellation, &failures, n]() {
+            ConstellationChecks::propagate(*constellation);
+            failures += checkSectorBatch(*constellation);
+            if (n == 0) {
+                ConstellationChecks::initializeSatIntraLinks(*constellation);
+            }
+            failures += checkSatelliteLinks(*constellation);
+        });
+    }
+    Simulator::Run();
+    Simulator::Destroy();
+
+    if (failures != 0) {
+        NS_LOG_UNCOND("[!] " << failures << " checks failed");
+        return 1;
+    }
+    NS_LOG_UNCOND("[+] All checks passed");
+    return 0;
+}
@@ -39,16 +39,14 @@ Vector projectOntoPlane(Vector fromVec, Vector normVecZ){
 
 
 std::pair<double, double> getAngleFromSatPair(Ptr<SatSGP4MobilityModel>sat0, Ptr<SatSGP4MobilityModel>sat1) {
-    // Get the ECEF positions of the satellites
-    Vector sat0_r = sat0->GetPosition();
-    Vector sat1_r = sat1->GetPosition();
-    NS_LOG_DEBUG("[LH] sat0_r: " << sat0_r);
-    NS_LOG_DEBUG("[LH] sat1_r: " << sat1_r);
+    // Get the ECEF positions and velocity vectors of the satellites
+    return getAngleFromSatPair(sat0->GetPosition(), sat0->GetVelocity(), sat1->GetPosition(), sat1->GetVelocity());
+}
 
 
-    // Get their velocity vectors
-    Vector sat0_v = sat0->GetVelocity();
-    Vector sat1_v = sat1->GetVelocity();
+std::pair<double, double> getAngleFromSatPair(Vector sat0_r, Vector sat0_v, Vector sat1_r, Vector sat1_v) {
+    NS_LOG_DEBUG("[LH] sat0_r: " << sat0_r);
+    NS_LOG_DEBUG("[LH] sat1_r: " << sat1_r);
     NS_LOG_DEBUG("[LH] sat0_v: " << sat0_v);
     NS_LOG_DEBUG("[LH] sat1_v: " << sat1_v);
 
@@ -119,3 +117,106 @@ std::pair<double, double> getAngleFromSatPair(Ptr<SatSGP4MobilityModel>sat0, Ptr
     //  Second: The angle from sat1 to sat0 from sat0's POV with regards to sat1's velocity
     return std::pair(angle_sat0_to_sat1, angle_sat1_to_sat0);
 }
+
+
+int getSectorFromAngle(double angle) {
+    // Wrap angles below -45 degrees around, such that the backwards and right sectors are continuous
+    if (angle < -45) {
+        angle = abs(angle);
+        angle = 360 - angle;
+    }
+    for (int sector = 1; sector <= 4; sector++) {
+        if (angle >= NetDeviceAngles[sector - 1].minAngle && angle < NetDeviceAngles[sector - 1].maxAngle) {
+            return sector;
+        }
+    }
+    return 0;
+}
+
+
+void SRFBasisCache::resize(uint32_t satCount) {
+    for (std::vector<double>* axis : {&xx, &xy, &xz, &yx, &yy, &yz, &zx, &zy, &zz}) {
+        axis->resize(satCount);
+    }
+}
+
+
+void SRFBasisCache::compute(const double* x, const double* y, const double* z,
+                            const double* vx, const double* vy, const double* vz,
+                            uint32_t begin, uint32_t end) {
+    // Same operations as normalizeVector() and vectorCrossProduct() in getAngleFromSatPair(), written out on plain arrays
+    for (uint32_t n = begin; n < end; n++) {
+        double vMag = std::sqrt(vx[n] * vx[n] + vy[n] * vy[n] + vz[n] * vz[n]);
+        this->xx[n] = vx[n] / vMag;
+        this->xy[n] = vy[n] / vMag;
+        this->xz[n] = vz[n] / vMag;
+
+        double crossX = y[n] * vz[n] - z[n] * vy[n];
+        double crossY = z[n] * vx[n] - x[n] * vz[n];
+        double crossZ = x[n] * vy[n] - y[n] * vx[n];
+        double crossMag = std::sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ);
+        this->yx[n] = crossX / crossMag;
+        this->yy[n] = crossY / crossMag;
+        this->yz[n] = crossZ / crossMag;
+
+        double rMag = std::sqrt(x[n] * x[n] + y[n] * y[n] + z[n] * z[n]);
+        this->zx[n] = x[n] / rMag;
+        this->zy[n] = y[n] / rMag;
+        this->zz[n] = z[n] / rMag;
+    }
+}
+
+
+void SectorBatchScratch::reserve(uint32_t count) {
+    if (this->xScalars.size() < count) {
+        this->xScalars.resize(count);
+        this->yScalars.resize(count);
+        this->connXScalars.resize(count);
+        this->connYScalars.resize(count);
+    }
+}
+
+
+void getSectorsFromSatBatch(uint32_t satIndex, const uint32_t* neighbours, uint32_t count,
+                            const double* x, const double* y, const double* z,
+                            const SRFBasisCache& bases, SectorBatchScratch& scratch, int* sectors, int* connSectors) {
+    const uint32_t s = satIndex;
+    scratch.reserve(count);
+    double* xScalars = scratch.xScalars.data();
+    double* yScalars = scratch.yScalars.data();
+    double* connXScalars = scratch.connXScalars.data();
+    double* connYScalars = scratch.connYScalars.data();
+
+    // First pass: project the relative vectors onto both SRFs. No branches, so this loop can be vectorized
+    for (uint32_t n = 0; n < count; n++) {
+        const uint32_t c = neighbours[n];
+
+        // Vector from the satellite to the neighbour, in the satellites SRF
+        double dx = x[c] - x[s];
+        double dy = y[c] - y[s];
+        double dz = z[c] - z[s];
+        double dotZ = dx * bases.zx[s] + dy * bases.zy[s] + dz * bases.zz[s];
+        double px = dx - dotZ * bases.zx[s];
+        double py = dy - dotZ * bases.zy[s];
+        double pz = dz - dotZ * bases.zz[s];
+        xScalars[n] = px * bases.xx[s] + py * bases.xy[s] + pz * bases.xz[s];
+        yScalars[n] = px * bases.yx[s] + py * bases.yy[s] + pz * bases.yz[s];
+
+        // Vector from the neighbour back to the satellite, in the neighbours SRF
+        double cdx = x[s] - x[c];
+        double cdy = y[s] - y[c];
+        double cdz = z[s] - z[c];
+        double cDotZ = cdx * bases.zx[c] + cdy * bases.zy[c] + cdz * bases.zz[c];
+        double cpx = cdx - cDotZ * bases.zx[c];
+        double cpy = cdy - cDotZ * bases.zy[c];
+        double cpz = cdz - cDotZ * bases.zz[c];
+        connXScalars[n] = cpx * bases.xx[c] + cpy * bases.xy[c] + cpz * bases.xz[c];
+        connYScalars[n] = cpx * bases.yx[c] + cpy * bases.yy[c] + cpz * bases.yz[c];
+    }
+
+    // Second pass: convert to angles in degrees and find the sectors
+    for (uint32_t n = 0; n < count; n++) {
+        sectors[n] = getSectorFromAngle(atan2(yScalars[n], xScalars[n]) * 180 / M_PI);
+        connSectors[n] = getSectorFromAngle(atan2(connYScalars[n], connXScalars[n]) * 180 / M_PI);
+    }
+}
@@ -3,8 +3,63 @@
 
 #include "ns3/satellite-module.h"
 
+#include <vector>
+
 using namespace ns3;
 
+typedef struct AngleRange
+{
+    double minAngle;
+    double maxAngle;
+} AngleRange;
+
+/**
+Angle ranges of the four inter-satellite terminals (NetDevices 1-4), measured from the velocity vector in the SRF.
+Angles below -45 degrees are wrapped around to 180-315 degrees first, so every angle falls in exactly one range.
+*/
+const AngleRange NetDeviceAngles[4] = {
+    { -45.0,  45.0 }, // NetDev1 forward
+    {  45.0, 135.0 }, // NetDev2 left
+    { 135.0, 225.0 }, // NetDev3 back
+    { 225.0, 315.0 }  // NetDev4 right
+};
+
+/**
+Orthonormal bases of the satellite reference frames (SRF) of a whole constellation, stored as structure of arrays.
+x points along the velocity, y along position x velocity and z along the position. Index n is satellite n.
+Computed once per update, so the frames do not have to be rebuilt for every pair of satellites.
+*/
+class SRFBasisCache
+{
+    public:
+        std::vector<double> xx, xy, xz;
+        std::vector<double> yx, yy, yz;
+        std::vector<double> zx, zy, zz;
+
+        /**
+        Compute the basis of satellites [begin, end) from their ECEF positions and velocities. The vectors must already be
+        resized to hold all satellites, such that separate ranges can be computed by separate threads.
+        */
+        void compute(const double* x, const double* y, const double* z,
+                     const double* vx, const double* vy, const double* vz,
+                     uint32_t begin, uint32_t end);
+
+        void resize(uint32_t satCount);
+};
+
+/**
+Work buffers of getSectorsFromSatBatch(). A caller running it in a loop, e.g. once per satellite in a thread pool worker,
+keeps one of these around such that the buffers are only allocated when a batch is larger than any before.
+*/
+class SectorBatchScratch
+{
+    public:
+        std::vector<double> xScalars, yScalars;
+        std::vector<double> connXScalars, connYScalars;
+
+        void reserve(uint32_t count);
+};
+
 /**
 Calculates both the angle from sat0's velocity vector and a vector pointing at sat1 and the opposite
 order also. Calculations are based on ECEF system and take place in each satellites local reference
@@ -13,6 +68,26 @@ sat0 to sat1 and sat1 to sat0 in that order.
 */
 std::pair<double, double> getAngleFromSatPair(Ptr<SatSGP4MobilityModel>sat0, Ptr<SatSGP4MobilityModel>sat1);
 
+/**
+Same as above, but based on ECEF positions and velocities that have already been propagated, e.g. from a
+ConstellationState snapshot. Avoids running SGP4 again for every pair of satellites.
+*/
+std::pair<double, double> getAngleFromSatPair(Vector sat0_r, Vector sat0_v, Vector sat1_r, Vector sat1_v);
+
+/**
+Returns the terminal sector (NetDevice 1-4) that an angle from getAngleFromSatPair() falls into, or 0 if the angle is not a number.
+*/
+int getSectorFromAngle(double angle);
+
+/**
+Batch version of getAngleFromSatPair() + getSectorFromAngle() for one satellite against 'count' neighbours, using the cached
+SRF bases. For each neighbour n, 'sectors[n]' is set to the sector 'satIndex' sees neighbours[n] in, and 'connSectors[n]' to the
+sector neighbours[n] sees 'satIndex' in. The arithmetic is done in the same order as the scalar version, so the results are identical.
+*/
+void getSectorsFromSatBatch(uint32_t satIndex, const uint32_t* neighbours, uint32_t count,
+                            const double* x, const double* y, const double* z,
+                            const SRFBasisCache& bases, SectorBatchScratch& scratch, int* sectors, int* connSectors);
+
 /**
 Normalizes a vector to have lenght 1.
 */
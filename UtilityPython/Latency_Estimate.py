@@ -0,0 +1,291 @@
+"""
+This script estimates the propagation RTT between two ground stations when routing on the fewest hops, and when routing on
+the lowest latency, without running the simulator. It places the satellites with a two-body propagation with J2 drift from
+the TLE elements, instead of SGP4, and builds the links with the same rules as the simulator (sectors of the satellite
+reference frame, maximum distances, minimum elevation and the "first" handover policy), but assigns them from scratch at
+every snapshot instead of maintaining them. The results are therefore an estimate of the propagation part of the RTT,
+and no replacement for comparing two simulator runs with RTT_Compare.py, see "Routing metrics" in the README
+"""
+import argparse
+import heapq
+import math
+from datetime import datetime, timedelta, timezone
+
+MU = 398600.4418            # km^3/s^2
+EARTH_RADIUS = 6378.137     # km
+J2 = 1.08262668e-3
+EARTH_ROTATION = 7.2921159e-5   # rad/s
+C = 299792.458              # km/s
+
+MAX_SAT_TO_SAT_DISTANCE = 5000  # km
+MAX_GS_TO_SAT_DISTANCE = 3000   # km
+MIN_GS_ELEVATION = 5            # degrees
+
+GROUND_STATIONS = [
+    ("New York", 40.7114, -74.0115, 20),
+    ("Dubai", 25.2173, 55.2829, 20),
+]
+
+
+def read_orbits(path: str) -> list:
+    """
+    Returns the satellite names of all orbits, in the order the simulator creates them
+    """
+    with open(path, 'r') as file:
+        lines = [line.strip() for line in file if line.strip()]
+    names = []
+    for satellites in lines[1::2]:
+        names.extend(name.strip() for name in satellites.split(','))
+    return names
+
+
+def read_tle(path: str) -> tuple:
+    """
+    Returns the start time of the simulation and the elements of every satellite in the TLE file
+    """
+    with open(path, 'r') as file:
+        lines = [line.rstrip() for line in file if line.strip()]
+    start = datetime.strptime(lines[0], "%Y-%m-%d %H:%M:%S").replace(tzinfo=timezone.utc)
+    elements = {}
+    for n in range(1, len(lines) - 2, 3):
+        name, line1, line2 = lines[n].strip(), lines[n + 1], lines[n + 2]
+        year = int(line1[18:20])
+        epoch = datetime(2000 + year if year < 57 else 1900 + year, 1, 1, tzinfo=timezone.utc)
+        epoch += timedelta(days=float(line1[20:32]) - 1)
+        elements[name] = {
+            "epoch": epoch,
+            "inclination": math.radians(float(line2[8:16])),
+            "raan": math.radians(float(line2[17:25])),
+            "eccentricity": float("0." + line2[26:33]),
+            "perigee": math.radians(float(line2[34:42])),
+            "anomaly": math.radians(float(line2[43:51])),
+            "motion": float(line2[52:63]) * 2 * math.pi / 86400,    # rad/s
+        }
+    return start, elements
+
+
+def gmst(time: datetime) -> float:
+    days = (time - datetime(2000, 1, 1, 12, tzinfo=timezone.utc)).total_seconds() / 86400
+    return math.radians((280.46061837 + 360.98564736629 * days) % 360)
+
+
+def propagate(element: dict, time: datetime) -> tuple:
+    """
+    Returns the earth fixed position (km) and velocity (km/s) of a satellite
+    """
+    dt = (time - element["epoch"]).total_seconds()
+    n, e, i = element["motion"], element["eccentricity"], element["inclination"]
+    a = (MU / n ** 2) ** (1 / 3)
+    p = a * (1 - e ** 2)
+    drift = 1.5 * J2 * (EARTH_RADIUS / p) ** 2 * n
+    raan = element["raan"] - drift * math.cos(i) * dt
+    perigee = element["perigee"] + drift * (2 - 2.5 * math.sin(i) ** 2) * dt
+    mean = element["anomaly"] + n * dt
+
+    eccentric = mean
+    for _ in range(10):
+        eccentric -= (eccentric - e * math.sin(eccentric) - mean) / (1 - e * math.cos(eccentric))
+    true = 2 * math.atan2(math.sqrt(1 + e) * math.sin(eccentric / 2), math.sqrt(1 - e) * math.cos(eccentric / 2))
+    r = a * (1 - e * math.cos(eccentric))
+    h = math.sqrt(MU * p)
+
+    # Position and velocity in the orbital plane, rotated into the inertial frame
+    px, py = r * math.cos(true), r * math.sin(true)
+    vx, vy = -MU / h * math.sin(true), MU / h * (e + math.cos(true))
+    cO, sO, cw, sw, ci, si = math.cos(raan), math.sin(raan), math.cos(perigee), math.sin(perigee), math.cos(i), math.sin(i)
+    rotation = [
+        (cO * cw - sO * sw * ci, -cO * sw - sO * cw * ci),
+        (sO * cw + cO * sw * ci, -sO * sw + cO * cw * ci),
+        (sw * si, cw * si),
+    ]
+    position = [row[0] * px + row[1] * py for row in rotation]
+    velocity = [row[0] * vx + row[1] * vy for row in rotation]
+
+    # Rotate into the earth fixed frame, which also takes the rotation of the earth out of the velocity
+    theta = gmst(time)
+    ct, st = math.cos(theta), math.sin(theta)
+    x, y, z = ct * position[0] + st * position[1], -st * position[0] + ct * position[1], position[2]
+    vx, vy, vz = ct * velocity[0] + st * velocity[1], -st * velocity[0] + ct * velocity[1], velocity[2]
+    return (x, y, z), (vx + EARTH_ROTATION * y, vy - EARTH_ROTATION * x, vz)
+
+
+def ground_position(latitude: float, longitude: float, altitude: float) -> tuple:
+    lat, lon = math.radians(latitude), math.radians(longitude)
+    flattening = 1 / 298.257223563
+    e2 = flattening * (2 - flattening)
+    radius = EARTH_RADIUS / math.sqrt(1 - e2 * math.sin(lat) ** 2)
+    alt = altitude / 1000
+    return ((radius + alt) * math.cos(lat) * math.cos(lon), (radius + alt) * math.cos(lat) * math.sin(lon),
+            (radius * (1 - e2) + alt) * math.sin(lat))
+
+
+def sub(a: tuple, b: tuple) -> tuple:
+    return a[0] - b[0], a[1] - b[1], a[2] - b[2]
+
+
+def dot(a: tuple, b: tuple) -> float:
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]
+
+
+def cross(a: tuple, b: tuple) -> tuple:
+    return a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]
+
+
+def norm(a: tuple) -> float:
+    return math.sqrt(dot(a, a))
+
+
+def sector(position: tuple, velocity: tuple, towards: tuple) -> int:
+    """
+    Returns the terminal (1-4) of the satellite that points towards the given position, same as getSectorFromAngle()
+    """
+    z = position
+    relative = sub(towards, position)
+    projected = sub(relative, tuple(dot(relative, z) / dot(z, z) * c for c in z))
+    angle = math.degrees(math.atan2(dot(projected, cross(position, velocity)) / norm(cross(position, velocity)),
+                                    dot(projected, velocity) / norm(velocity)))
+    if angle < -45:
+        angle += 360
+    return int((angle + 45) // 90) + 1
+
+
+def assign_links(positions: list, velocities: list) -> list:
+    """
+    Returns the satellite links as (satellite, peer, distance), assigned in the same order as the simulator's full scan
+    """
+    count = len(positions)
+    free = [[1, 2, 3, 4] for _ in range(count)]
+    links = []
+    for sat in range(count):
+        for terminal in list(free[sat]):
+            for peer in range(count):
+                if peer == sat or not free[peer] or terminal not in free[sat]:
+                    continue
+                distance = norm(sub(positions[peer], positions[sat]))
+                if distance > MAX_SAT_TO_SAT_DISTANCE:
+                    continue
+                if sector(positions[sat], velocities[sat], positions[peer]) != terminal:
+                    continue
+                peerTerminal = sector(positions[peer], velocities[peer], positions[sat])
+                if peerTerminal in free[peer]:
+                    free[sat].remove(terminal)
+                    free[peer].remove(peerTerminal)
+                    links.append((sat, peer, distance))
+                    break
+    return links
+
+
+def elevation(ground: tuple, satellite: tuple) -> float:
+    relative = sub(satellite, ground)
+    return math.degrees(math.asin(dot(relative, ground) / (norm(relative) * norm(ground))))
+
+
+def shortest_paths(graph: dict, source: int, target: int) -> tuple:
+    """
+    Returns the latency (ms) of the fastest path, and the fastest and slowest latency among the paths with the fewest hops
+    """
+    best = {source: 0.0}
+    queue = [(0.0, source)]
+    while queue:
+        latency, node = heapq.heappop(queue)
+        if latency > best[node]:
+            continue
+        for peer, delay in graph[node]:
+            if latency + delay < best.get(peer, math.inf):
+                best[peer] = latency + delay
+                heapq.heappush(queue, (best[peer], peer))
+    if target not in best:
+        return None
+
+    # Breadth first, keeping the fastest and slowest latency to every node over its fewest hop paths
+    hops = {source: 0}
+    fastest, slowest = {source: 0.0}, {source: 0.0}
+    frontier = [source]
+    while frontier and target not in hops:
+        following = []
+        for node in frontier:
+            for peer, delay in graph[node]:
+                if peer not in hops:
+                    hops[peer] = hops[node] + 1
+                    fastest[peer], slowest[peer] = math.inf, -math.inf
+                    following.append(peer)
+                if hops[peer] == hops[node] + 1:
+                    fastest[peer] = min(fastest[peer], fastest[node] + delay)
+                    slowest[peer] = max(slowest[peer], slowest[node] + delay)
+        frontier = following
+    return best[target], fastest[target], slowest[target], hops[target]
+
+
+def shortest_paths_hops(graph: dict, source: int, target: int, latency: float) -> int:
+    """
+    Returns the amount of hops of the fastest path
+    """
+    best = {source: (0.0, 0)}
+    queue = [(0.0, 0, source)]
+    while queue:
+        delay, hops, node = heapq.heappop(queue)
+        if node == target:
+            return hops
+        if (delay, hops) > best[node]:
+            continue
+        for peer, linkDelay in graph[node]:
+            candidate = (delay + linkDelay, hops + 1)
+            if candidate < best.get(peer, (math.inf, 0)):
+                best[peer] = candidate
+                heapq.heappush(queue, (candidate[0], candidate[1], peer))
+    return -1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--tledata", default="scratch/P5-Satellite/resources/starlink_13-11-2024_tle_data.txt")
+    parser.add_argument("--tleorbits", default="scratch/P5-Satellite/resources/starlink_13-11-2024_orbits.txt")
+    parser.add_argument("--simTime", type=int, default=10, help="Time in minutes to estimate for")
+    parser.add_argument("--updateInterval", type=int, default=15, help="Time in seconds between snapshots")
+    args = parser.parse_args()
+
+    start, elements = read_tle(args.tledata)
+    names = [name for name in read_orbits(args.tleorbits) if name in elements]
+    grounds = [ground_position(lat, lon, alt) for _, lat, lon, alt in GROUND_STATIONS]
+
+    print(f"{'time (s)':>8}{'hops':>6}{'hop RTT (ms)':>18}{'latency RTT (ms)':>18}{'hops':>6}")
+    rtts = {"hops best": [], "hops worst": [], "latency": []}
+    for seconds in range(0, args.simTime * 60, args.updateInterval):
+        time = start + timedelta(seconds=seconds)
+        states = [propagate(elements[name], time) for name in names]
+        positions, velocities = [s[0] for s in states], [s[1] for s in states]
+
+        graph = {node: [] for node in range(len(names) + len(grounds))}
+        for sat, peer, distance in assign_links(positions, velocities):
+            graph[sat].append((peer, distance / C * 1000))
+            graph[peer].append((sat, distance / C * 1000))
+        taken = set()
+        for gsIndex, ground in enumerate(grounds):
+            for sat, position in enumerate(positions):
+                distance = norm(sub(position, ground))
+                if sat in taken or distance > MAX_GS_TO_SAT_DISTANCE or elevation(ground, position) < MIN_GS_ELEVATION:
+                    continue
+                taken.add(sat)
+                graph[len(names) + gsIndex].append((sat, distance / C * 1000))
+                graph[sat].append((len(names) + gsIndex, distance / C * 1000))
+                break
+
+        paths = shortest_paths(graph, len(names), len(names) + 1)
+        if paths is None:
+            print(f"{seconds:>8}{'no route':>30}")
+            continue
+        latency, fastest, slowest, hops = paths
+        latencyHops = shortest_paths_hops(graph, len(names), len(names) + 1, latency)
+        rtts["latency"].append(2 * latency)
+        rtts["hops best"].append(2 * fastest)
+        rtts["hops worst"].append(2 * slowest)
+        print(f"{seconds:>8}{hops:>6}{2 * fastest:>8.2f} - {2 * slowest:>7.2f}{2 * latency:>18.2f}{latencyHops:>6}")
+
+    if rtts["latency"]:
+        print()
+        for name, values in rtts.items():
+            print(f"{name:12} mean {sum(values) / len(values):7.2f} ms, max {max(values):7.2f} ms over {len(values)} snapshots")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,77 @@
+"""
+This script compares the RTT of two runs of the same scenario, such as one with --routingMetric=hops and one with
+--routingMetric=latency. Each run's RTT_data_*.txt files must be in their own directory, see "Routing metrics" in the README
+"""
+import math
+import os
+import sys
+
+import matplotlib.pyplot as plt
+
+
+def read_rtts(directory: str) -> tuple:
+    """
+    Returns the (time (s), RTT (ms)) samples of every RTT file in the directory, sorted by time
+    """
+    samples = []
+    for filename in sorted(os.listdir(directory)):
+        if not filename.startswith("RTT"):
+            continue
+        with open(os.path.join(directory, filename), 'r') as file:
+            for line in file.readlines()[1:]:  # Skip the header line
+                t, rtt = map(float, line.strip().split(','))
+                # Convert ns to ms
+                samples.append((t, rtt / 1_000_000))
+    samples.sort()
+    return [t for t, _ in samples], [rtt for _, rtt in samples]
+
+
+def percentile(values: list, p: float) -> float:
+    ordered = sorted(values)
+    index = max(0, math.ceil(p / 100 * len(ordered)) - 1)
+    return ordered[index]
+
+
+def summary(rtts: list) -> dict:
+    return {
+        "samples": len(rtts),
+        "mean": sum(rtts) / len(rtts),
+        "median": percentile(rtts, 50),
+        "p95": percentile(rtts, 95),
+        "max": max(rtts),
+    }
+
+
+def compare(runs: dict):
+    stats = {}
+    for name, directory in runs.items():
+        times, rtts = read_rtts(directory)
+        if not rtts:
+            print(f"No RTT samples in {directory}")
+            return
+        stats[name] = summary(rtts)
+        plt.plot(times, rtts, marker='o', markersize=2, linestyle='', label=name)
+
+    names = list(stats)
+    print(f"{'':10}" + "".join(f"{name:>14}" for name in names) + f"{'change':>10}")
+    for key in ["samples", "mean", "median", "p95", "max"]:
+        values = [stats[name][key] for name in names]
+        row = f"{key:10}" + "".join(f"{value:>14.3f}" if key != "samples" else f"{value:>14}" for value in values)
+        if key != "samples" and len(values) == 2:
+            row += f"{100 * (values[1] - values[0]) / values[0]:>9.1f}%"
+        print(row)
+
+    plt.title('RTT per routing metric', fontsize=36)
+    plt.xlabel('Time (s)', fontsize=30)
+    plt.ylabel('Round Trip Time (ms)', fontsize=30)
+    plt.tick_params(axis='both', which='major', labelsize=26)
+    plt.legend(fontsize=24)
+    plt.grid(True)
+    plt.show()
+
+
+if __name__ == "__main__":
+    hops = sys.argv[1] if len(sys.argv) > 1 else "scratch/P5-Satellite/out/hops"
+    latency = sys.argv[2] if len(sys.argv) > 2 else "scratch/P5-Satellite/out/latency"
+
+    compare({"hops": hops, "latency": latency})
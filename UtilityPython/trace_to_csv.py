@@ -0,0 +1,67 @@
+"""
+This script converts the binary traces written with --traceFormat=binary into the CSV files that
+CWND_Plotter.py and RTT_Plotter.py read, exactly as the csv trace format would have written them
+"""
+import csv
+import os
+import struct
+import sys
+
+# time (s), value, stream id - see TraceRecord in traceWriter.h
+RECORD = struct.Struct("<ddI")
+
+
+def read_streams(streams_path: str) -> dict:
+    """
+    Returns {stream id: (kind, node, socket)}
+    """
+    streams = {}
+    with open(streams_path, 'r') as file:
+        for row in csv.DictReader(file):
+            streams[int(row["id"])] = (row["kind"], int(row["node"]), int(row["socket"]))
+    return streams
+
+
+def open_csv(directory: str, kind: str, node: int, socket: int):
+    """
+    Opens the CSV file of a stream under the same name and with the same header as SetupTracing() uses
+    """
+    if kind == "cwnd":
+        file = open(os.path.join(directory, f"CongestionWindow_Node{node}_Socket{socket}.txt"), 'w')
+        file.write("time(s),CongestionWindow\n")
+        # At time 0 the CWND=0, which the trace source never reports
+        file.write("0,0\n")
+    elif kind == "rtt":
+        file = open(os.path.join(directory, f"RTT_data_node{node}_socket{socket}.txt"), 'w')
+        file.write("Packet,RTT\n")
+    else:
+        raise ValueError(f"Unknown stream kind {kind}")
+    return file
+
+
+def convert(prefix: str):
+    directory = os.path.dirname(prefix)
+    streams = read_streams(prefix + ".streams")
+    files = {stream_id: open_csv(directory, *stream) for stream_id, stream in streams.items()}
+
+    with open(prefix + ".bin", 'rb') as records:
+        while True:
+            chunk = records.read(RECORD.size * 65536)
+            if not chunk:
+                break
+            for time, value, stream_id in RECORD.iter_unpack(chunk[:len(chunk) - len(chunk) % RECORD.size]):
+                # Same formatting as the default C++ stream output, 6 significant digits
+                if streams[stream_id][0] == "cwnd":
+                    files[stream_id].write(f"{time:g},{int(value)}\n")
+                else:
+                    files[stream_id].write(f"{time:g},{value:g}\n")
+
+    for file in files.values():
+        file.close()
+    print(f"Converted {len(files)} streams from {prefix}.bin")
+
+
+if __name__ == "__main__":
+    prefix = sys.argv[1] if len(sys.argv) > 1 else "scratch/P5-Satellite/out/traces"
+
+    convert(prefix)
@@ -0,0 +1,204 @@
+#include "constellationCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <unistd.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Constellation-Cache");
+
+namespace
+{
+    constexpr uint64_t fnvOffsetBasis = 14695981039346656037ULL;
+    constexpr uint64_t fnvPrime = 1099511628211ULL;
+
+    uint64_t fnv1a(uint64_t hash, std::string_view bytes) {
+        for (char c : bytes) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= fnvPrime;
+        }
+        return hash;
+    }
+}
+
+uint64_t ConstellationCache::computeKey(const std::string& tleDataPath, const std::string& orbitsDataPath, uint32_t satCount) {
+    MappedFile tleFile(tleDataPath);
+    MappedFile orbitsFile(orbitsDataPath);
+
+    uint64_t hash = fnv1a(fnvOffsetBasis, tleFile.view());
+    // Hash the lengths as well, so bytes moving from the end of one file to the start of the other change the key
+    uint64_t tleSize = tleFile.view().size();
+    hash = fnv1a(hash, std::string_view(reinterpret_cast<const char*>(&tleSize), sizeof(tleSize)));
+    hash = fnv1a(hash, orbitsFile.view());
+    hash = fnv1a(hash, std::string_view(reinterpret_cast<const char*>(&satCount), sizeof(satCount)));
+    return hash;
+}
+
+std::string ConstellationCache::pathForKey(const std::string& basePath, uint64_t key) {
+    std::ostringstream path;
+    path << basePath << "." << std::hex << std::setw(16) << std::setfill('0') << key;
+    return path.str();
+}
+
+bool ConstellationCache::write(const std::string& path, uint64_t key, std::string_view epoch, const std::vector<TLE>& satellites,
+                               const std::vector<TLEElements>& elements, const std::vector<Orbit>& orbits) {
+    NS_ASSERT_MSG(satellites.size() == elements.size(), "Every satellite needs its elements");
+
+    std::string strings(epoch);
+    auto addString = [&strings](std::string_view value) {
+        uint32_t offset = strings.size();
+        strings.append(value);
+        return offset;
+    };
+
+    std::vector<CachedSatellite> cachedSatellites(satellites.size());
+    for (size_t n = 0; n < satellites.size(); n++) {
+        cachedSatellites[n].nameOffset = addString(satellites[n].name);
+        cachedSatellites[n].nameLength = satellites[n].name.size();
+        cachedSatellites[n].linesOffset = addString(satellites[n].line1);
+        addString(satellites[n].line2);
+        cachedSatellites[n].elements = elements[n];
+    }
+
+    std::vector<CachedOrbit> cachedOrbits(orbits.size());
+    uint32_t firstSatellite = 0;
+    for (size_t n = 0; n < orbits.size(); n++) {
+        cachedOrbits[n].nameOffset = addString(orbits[n].name);
+        cachedOrbits[n].nameLength = orbits[n].name.size();
+        cachedOrbits[n].firstSatellite = firstSatellite;
+        cachedOrbits[n].satelliteCount = orbits[n].satellites.size();
+        firstSatellite += orbits[n].satellites.size();
+    }
+    NS_ASSERT_MSG(firstSatellite == satellites.size(), "The orbits do not cover the satellites exactly");
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "P5CC", 4);
+    header.version = version;
+    header.key = key;
+    header.satelliteCount = cachedSatellites.size();
+    header.orbitCount = cachedOrbits.size();
+    header.stringBytes = strings.size();
+    header.epochLength = epoch.size();
+
+    // Parallel runs may write the same cache at once, so every process writes its own temporary file
+    std::string tmpPath = path + ".tmp" + std::to_string(::getpid());
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        NS_LOG_WARN("Failed to open constellation cache for writing: " << tmpPath);
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(cachedSatellites.data()), cachedSatellites.size() * sizeof(CachedSatellite));
+    file.write(reinterpret_cast<const char*>(cachedOrbits.data()), cachedOrbits.size() * sizeof(CachedOrbit));
+    file.write(strings.data(), strings.size());
+    file.close();
+    if (!file.good()) {
+        NS_LOG_WARN("Failed to write constellation cache: " << tmpPath);
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    // Replaces the old cache atomically, a run that has it mapped keeps the old file until it unmaps it
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        NS_LOG_WARN("Failed to move constellation cache into place: " << path);
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ConstellationCache::open(const std::string& path, uint64_t key) {
+    this->file = MappedFile(path);
+    std::string_view bytes = this->file.view();
+    if (bytes.size() < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    const CacheHeader* fileHeader = reinterpret_cast<const CacheHeader*>(bytes.data());
+    if (std::memcmp(fileHeader->magic, "P5CC", 4) != 0 || fileHeader->version != version || fileHeader->key != key) {
+        NS_LOG_INFO("Constellation cache " << path << " does not match the inputs");
+        return false;
+    }
+    uint64_t expectedSize = sizeof(CacheHeader) + uint64_t(fileHeader->satelliteCount) * sizeof(CachedSatellite)
+                          + uint64_t(fileHeader->orbitCount) * sizeof(CachedOrbit) + fileHeader->stringBytes;
+    if (bytes.size() != expectedSize || fileHeader->epochLength > fileHeader->stringBytes) {
+        NS_LOG_WARN("Constellation cache " << path << " is damaged");
+        return false;
+    }
+
+    const char* cursor = bytes.data() + sizeof(CacheHeader);
+    const CachedSatellite* fileSatellites = reinterpret_cast<const CachedSatellite*>(cursor);
+    cursor += fileHeader->satelliteCount * sizeof(CachedSatellite);
+    const CachedOrbit* fileOrbits = reinterpret_cast<const CachedOrbit*>(cursor);
+    cursor += fileHeader->orbitCount * sizeof(CachedOrbit);
+    std::string_view fileStrings(cursor, fileHeader->stringBytes);
+
+    // Check every reference once, so the accessors do not have to
+    for (uint32_t n = 0; n < fileHeader->satelliteCount; n++) {
+        const CachedSatellite& satellite = fileSatellites[n];
+        if (uint64_t(satellite.nameOffset) + satellite.nameLength > fileStrings.size()
+            || uint64_t(satellite.linesOffset) + 2 * tleLineLength > fileStrings.size()) {
+            NS_LOG_WARN("Constellation cache " << path << " is damaged");
+            return false;
+        }
+    }
+    for (uint32_t n = 0; n < fileHeader->orbitCount; n++) {
+        const CachedOrbit& orbit = fileOrbits[n];
+        if (uint64_t(orbit.nameOffset) + orbit.nameLength > fileStrings.size()
+            || uint64_t(orbit.firstSatellite) + orbit.satelliteCount > fileHeader->satelliteCount) {
+            NS_LOG_WARN("Constellation cache " << path << " is damaged");
+            return false;
+        }
+    }
+
+    this->header = fileHeader;
+    this->satellites = fileSatellites;
+    this->orbits = fileOrbits;
+    this->strings = fileStrings;
+    return true;
+}
+
+std::string_view ConstellationCache::epoch() const {
+    return this->strings.substr(0, this->header->epochLength);
+}
+
+uint32_t ConstellationCache::satelliteCount() const {
+    return this->header->satelliteCount;
+}
+
+std::string_view ConstellationCache::satelliteName(uint32_t n) const {
+    return this->strings.substr(this->satellites[n].nameOffset, this->satellites[n].nameLength);
+}
+
+std::string_view ConstellationCache::satelliteLine1(uint32_t n) const {
+    return this->strings.substr(this->satellites[n].linesOffset, tleLineLength);
+}
+
+std::string_view ConstellationCache::satelliteLine2(uint32_t n) const {
+    return this->strings.substr(this->satellites[n].linesOffset + tleLineLength, tleLineLength);
+}
+
+const TLEElements& ConstellationCache::satelliteElements(uint32_t n) const {
+    return this->satellites[n].elements;
+}
+
+uint32_t ConstellationCache::orbitCount() const {
+    return this->header->orbitCount;
+}
+
+std::string_view ConstellationCache::orbitName(uint32_t n) const {
+    return this->strings.substr(this->orbits[n].nameOffset, this->orbits[n].nameLength);
+}
+
+uint32_t ConstellationCache::orbitFirstSatellite(uint32_t n) const {
+    return this->orbits[n].firstSatellite;
+}
+
+uint32_t ConstellationCache::orbitSatelliteCount(uint32_t n) const {
+    return this->orbits[n].satelliteCount;
+}
@@ -0,0 +1,104 @@
+#ifndef CONSTELLATION_CACHE_H
+#define CONSTELLATION_CACHE_H
+
+#include "tleHandler.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#pragma pack(push, 1)
+typedef struct CacheHeader
+{
+    char magic[4];              // "P5CC"
+    uint32_t version;
+    uint64_t key;               // ConstellationCache::computeKey() of the inputs the cache was built from
+    uint32_t satelliteCount;
+    uint32_t orbitCount;
+    uint32_t stringBytes;
+    uint32_t epochLength;       // the epoch is the first string in the string table
+} CacheHeader;
+
+typedef struct CachedSatellite
+{
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t linesOffset;       // line 1 directly followed by line 2, both always 69 characters
+    TLEElements elements;
+} CachedSatellite;
+
+// The satellites of an orbit are stored next to each other, in the same order as in the orbit file
+typedef struct CachedOrbit
+{
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t firstSatellite;
+    uint32_t satelliteCount;
+} CachedOrbit;
+#pragma pack(pop)
+
+static_assert(sizeof(CacheHeader) == 32, "CacheHeader is written to disk as is");
+static_assert(sizeof(CachedSatellite) == 74, "CachedSatellite is written to disk as is");
+static_assert(sizeof(CachedOrbit) == 16, "CachedOrbit is written to disk as is");
+
+/**
+ * Binary cache of the satellites and orbits that remain after filtering the TLE data by the orbit file, such that later
+ * runs with the same inputs can skip parsing the text files. The cache is memory mapped and read in place.
+ *
+ * On disk, the cache is the header, followed by the satellites, the orbits and finally the string table, in native byte order:
+ *   CacheHeader | CachedSatellite[satelliteCount] | CachedOrbit[orbitCount] | strings
+ */
+class ConstellationCache
+{
+    public:
+        /**
+         * FNV-1a hash of the contents of both input files and the requested satellite count.
+         */
+        static uint64_t computeKey(const std::string& tleDataPath, const std::string& orbitsDataPath, uint32_t satCount);
+
+        /**
+         * Path of the cache for 'key', '<basePath>.<key in hex>', such that runs with other inputs, like a sweep over the
+         * satellite count, each keep their own cache instead of overwriting a shared one.
+         */
+        static std::string pathForKey(const std::string& basePath, uint64_t key);
+
+        /**
+         * Write a cache for 'key'. The satellites must be ordered by orbit, such that the satellites of every orbit are
+         * consecutive in 'satellites'. Returns false if the file could not be written.
+         * The cache is written to a temporary file that is renamed into place, so a run that has the old cache mapped
+         * keeps reading it, and no run ever maps a half written cache.
+         */
+        static bool write(const std::string& path, uint64_t key, std::string_view epoch, const std::vector<TLE>& satellites,
+                          const std::vector<TLEElements>& elements, const std::vector<Orbit>& orbits);
+
+        /**
+         * Map the cache at 'path'. Returns false if it is missing, from another version, built for another key or damaged.
+         */
+        bool open(const std::string& path, uint64_t key);
+
+        std::string_view epoch() const;
+
+        uint32_t satelliteCount() const;
+        std::string_view satelliteName(uint32_t n) const;
+        std::string_view satelliteLine1(uint32_t n) const;
+        std::string_view satelliteLine2(uint32_t n) const;
+        const TLEElements& satelliteElements(uint32_t n) const;
+
+        uint32_t orbitCount() const;
+        std::string_view orbitName(uint32_t n) const;
+        uint32_t orbitFirstSatellite(uint32_t n) const;
+        uint32_t orbitSatelliteCount(uint32_t n) const;
+
+    private:
+        static constexpr uint32_t version = 2;
+        static constexpr uint32_t tleLineLength = 69;
+
+        MappedFile file;
+        const CacheHeader* header = nullptr;
+        const CachedSatellite* satellites = nullptr;
+        const CachedOrbit* orbits = nullptr;
+        std::string_view strings;
+};
+
+#endif
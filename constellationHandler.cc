@@ -8,11 +8,19 @@
 #include "ns3/point-to-point-module.h"
 // #include "ns3/csma-module.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("P5-Constellation-Handler");
 
-Constellation::Constellation(uint32_t satCount, std::string tleDataPath, std::string orbitsDataPath, uint32_t gsCount, std::vector<GeoCoordinate> groundStationsCoordinates, DataRate gsInputDataRate, DataRate satInputDataRate, double gsSatErrorRate, double satSatErrorRate, TimeValue linkAcquisitionSec) {
+Constellation::Constellation(uint32_t satCount, std::string tleDataPath, std::string orbitsDataPath, uint32_t gsCount, std::vector<GeoCoordinate> groundStationsCoordinates, DataRate gsInputDataRate, DataRate satInputDataRate, double gsSatErrorRate, double satSatErrorRate, TimeValue linkAcquisitionSec, std::string constellationCachePath) {
 
     // In the simulation, this Ipv4AddressGenerator keeps track of all allocated IPv4 addresses. If we want to remove an address and later allocate it to another Ipv4Interface, this generates an error! Therefore we enable "TestMode", which means it *does not* check if an new addresses have previously been allocated. Basicallly, enabling TestMode mimics the real world the most, as no one can keep a global record on which IP addresses have been assigned previously in history
     Ipv4AddressGenerator::TestMode();
@@ -33,47 +41,70 @@ Constellation::Constellation(uint32_t satCount, std::string tleDataPath, std::st
     this->satSatPacketLossRate = satSatErrorRate;
     // Link acquisition time!
     this->linkAcquisitionTime = linkAcquisitionSec;
-    
-    // Reserve memory for the vector.
-    this->availableSatNetDevices.reserve(this->satelliteCount);
-    
-
-    // TESTING PURPOSES 
-    // for (uint32_t n = 0; n < this->satelliteCount; ++n) {
-    //     for (uint32_t j = 0; j < this->availableSatNetDevices[n].size(); ++j) {
-    //         NS_LOG_UNCOND("Val: " << availableSatNetDevices[n][j]);
-    //     }
-    //     NS_LOG_UNCOND("\n");
-    // }
+    this->constellationCachePath = constellationCachePath;
+    // Inter satellite links get a /24 each from 2.0.0.0/8, unless told otherwise
+    this->setLinkAddressBlock("2.0.0.0/8", 24);
+    // Run serially until told otherwise
+    this->threadPool = std::make_unique<ThreadPool>(1);
 
     // Create the satellites in the constellation.
     this->satelliteNodes = this->createSatellitesFromTLEAndOrbits(tleDataPath, orbitsDataPath);
 
     // Create the ground stations in the constellation.
     this->groundStationNodes = this->createGroundStations(groundStationsCoordinates);
+    this->gsLinkCount.assign(this->groundStationNodes.GetN(), 0);
+    this->gsPreviousSatellite.assign(this->groundStationNodes.GetN(), NO_LINK);
+    // The ground stations are the last nodes created, so the table covers every node of the constellation
+    uint32_t lastNodeId = this->groundStationNodes.Get(this->groundStationNodes.GetN() - 1)->GetId();
+    this->linkTable.assign((lastNodeId + 1) * terminalsPerNode, {NO_LINK, 0, 0, Seconds(0), 0});
+    // Ground stations never move, so their positions only have to be stored once
+    this->state.setGroundStations(this->groundStationsMobilityModels);
+    this->ephemeris = Create<EphemerisWindow>();
+
+    // Only the route between the first two ground stations is tracked, unless told otherwise
+    this->routeRegistry = Create<RouteRegistry>();
+    if (this->groundStationNodes.GetN() >= 2) {
+        this->setTrackedFlows("0-1");
+    }
+
+    std::ostringstream eventsPath, flowsPath, breaksPath;
+    eventsPath << "scratch/P5-Satellite/out/events_satCount" << this->satelliteCount << ".csv";
+    flowsPath << "scratch/P5-Satellite/out/flows_satCount" << this->satelliteCount << ".csv";
+    breaksPath << "scratch/P5-Satellite/out/link_break_times_satCount" << this->satelliteCount << ".log";
+    this->journal = Create<EventJournal>(eventsPath.str());
+    // Both hold their own reference, so they are written out even if the constellation is gone by then
+    Ptr<EventJournal> journal = this->journal;
+    Ptr<RouteRegistry> routeRegistry = this->routeRegistry;
+    std::string flowsFile = flowsPath.str();
+    std::string breaksFile = breaksPath.str();
+    Simulator::ScheduleDestroy([journal, routeRegistry, flowsFile, breaksFile]() {
+        journal->close();
+        if (routeRegistry->getFlowCount() > 0) {
+            routeRegistry->write(flowsFile);
+            routeRegistry->writeBreakTimes(0, breaksFile);
+        }
+    });
 }
 
 
 NodeContainer Constellation::createSatellitesFromTLEAndOrbits(std::string tleDataPath, std::string orbitsDataPath) {
-    // Read orbit data
-    this->OrbitVector = ReadOrbitFile(orbitsDataPath);
-    NS_LOG_INFO("[+] Imported orbit data for " << this->OrbitVector.size() << " orbits");
-
-    // Read TLE data
-    std::string TLEAge;
-    this->TLEVector = ReadTLEFile(tleDataPath, TLEAge);
-
-    // For each satellite in the orbits, only grab those from the TLE data (filtering out the others)
-    std::vector<TLE> tmp;
-    for (Orbit orbit : this->OrbitVector) {
-        for (std::string name : orbit.satellites) {
-            for (TLE tle : this->TLEVector){
-                if (name == tle.name)
-                    tmp.push_back(tle);
-            }
+    // Skip parsing the text files when the cache was built from the exact same inputs
+    uint64_t cacheKey = 0;
+    std::string cachePath;
+    bool cacheHit = false;
+    if (!this->constellationCachePath.empty()) {
+        cacheKey = ConstellationCache::computeKey(tleDataPath, orbitsDataPath, this->satelliteCount);
+        cachePath = ConstellationCache::pathForKey(this->constellationCachePath, cacheKey);
+        cacheHit = this->loadConstellationCache(cachePath, cacheKey);
+    }
+    if (!cacheHit) {
+        this->readTLEAndOrbits(tleDataPath, orbitsDataPath);
+        if (!cachePath.empty() &&
+            ConstellationCache::write(cachePath, cacheKey, this->tleEpoch, this->TLEVector, this->satelliteElements, this->OrbitVector)) {
+            NS_LOG_INFO("[+] Constellation cache written to " << cachePath);
         }
     }
-    this->TLEVector = tmp;
+    std::string TLEAge = this->tleEpoch;
     NS_LOG_INFO("[+] Imported TLE data for " << this->TLEVector.size() << " satellites, with age " << TLEAge);
     NS_ASSERT_MSG(this->TLEVector.size() != 0, "No satellites were imported?");
 
@@ -84,9 +115,18 @@ NodeContainer Constellation::createSatellitesFromTLEAndOrbits(std::string tleDat
     }
 
     // populate the available netdevices since they are all available at this moment
-    for (uint32_t n = 0; n < this->satelliteCount; ++n) { 
-        std::vector<int> availableNetDevs = {1, 2, 3, 4};
-        this->availableSatNetDevices.emplace_back(availableNetDevs);
+    this->freeTerminalMasks.assign(this->satelliteCount, allTerminalsFree);
+    this->satsWithFreeTerminals.resize(this->satelliteCount);
+    this->freeTerminalListPositions.resize(this->satelliteCount);
+    // The full scan starts out with netdevices 1 to 4 in ascending order
+    this->terminalReleaseOrder.assign(this->satelliteCount * terminalsPerNode, 0);
+    this->terminalReleaseCount = terminalsPerNode;
+    for (uint32_t n = 0; n < this->satelliteCount; ++n) {
+        this->satsWithFreeTerminals[n] = n;
+        this->freeTerminalListPositions[n] = n;
+        for (int netDevIndex = 1; netDevIndex <= 4; netDevIndex++) {
+            this->terminalReleaseOrder[n * terminalsPerNode + netDevIndex] = netDevIndex;
+        }
     }
 
 
@@ -100,20 +140,13 @@ NodeContainer Constellation::createSatellitesFromTLEAndOrbits(std::string tleDat
     stackHelper.Install(satellites);
     NS_LOG_INFO("[+] Internet stack installed on satellites");
 
-    PointToPointHelper p2pHelper;
-    
     // Setup the error model
     Ptr<RateErrorModel> error_model = CreateObject<RateErrorModel>();
     error_model->SetUnit(RateErrorModel::ERROR_UNIT_BIT);
     error_model->SetRate(satSatPacketLossRate);
-    p2pHelper.SetDeviceAttribute("ReceiveErrorModel", PointerValue(error_model));
     
     std::string formatted_TLE;
 
-    Ptr<Node> dummyNode = CreateObject<Node>();
-    // Give it a constant mobility model to avoid warning in terminal
-    AnimationInterface::SetConstantPosition(dummyNode, 180, -90);
-
     // Loop through each satellite and set them up
     for (uint32_t n = 0; n < this->satelliteCount; ++n) {
         Ipv4AddressHelper tmpAddrHelper;
@@ -123,30 +156,16 @@ NodeContainer Constellation::createSatellitesFromTLEAndOrbits(std::string tleDat
         for (int i = 1; i <= 5; ++i) {
             Ptr<Node> currentSat = satellites.Get(n);
             Ptr<Ipv4> satIpv4 = currentSat->GetObject<Ipv4>();
-            // Use .Install() to get both a PointToPointNetDevice and a Channel on a new NetDevice
-            
-            Ptr<NetDevice> device = p2pHelper.Install(NodeContainer(currentSat, dummyNode)).Get(0);
-            
+            // If NetDevice is connected to either GS or SAT, set the appropriate DataRate
+            DataRate dataRate = (i == 5) ? this->gsToSatDataRate : this->satToSatDataRate;
+            // The device keeps its channel for the whole simulation, links only connect and disconnect it
+            Ptr<PointToPointNetDevice> device = this->createTerminal(currentSat, dataRate, error_model);
 
             // This is to utilize the importance of the assign() function, while ensuring that they do not have an IP address afterwards
             // So we just assign an arbitrary address to each satellite, and then remove that address right after
-            tmpAddrHelper.Assign(device);
+            tmpAddrHelper.Assign(NetDeviceContainer(device));
             satIpv4->RemoveAddress(i, 0);
             satIpv4->SetDown(i);
-            
-            // Delete the channel (free memory)
-            device->GetChannel()->Dispose();
-            // Make sure that channel pointer is pointing to the null channel, since channel is now destroyed
-            Ptr<PointToPointNetDevice> currP2pNetDevice = DynamicCast<PointToPointNetDevice>(device);
-            Ptr<PointToPointChannel> nullChannel = CreateObject<PointToPointChannel>();
-            currP2pNetDevice->Attach(nullChannel);
-            
-            
-            // If NetDevice is connected to either GS or SAT, set the appropriate DataRate
-            if (i == 5)
-                currP2pNetDevice->SetDataRate(this->gsToSatDataRate);
-            else
-                currP2pNetDevice->SetDataRate(this->satToSatDataRate);
         }
 
         // Create and aggregate the Satellite SGP4 mobility model to each satellite
@@ -163,12 +182,81 @@ NodeContainer Constellation::createSatellitesFromTLEAndOrbits(std::string tleDat
         Names::Add(this->TLEVector[n].name, satellites.Get(n));
 
         // IMPORTANT: When enabling this pcap trace, it will create 5 pcap files FOR EACH satellite. If running with many satellites, this might slow down your run substantiually
-        // p2pHelper.EnablePcap("scratch/P5-Satellite/out/satellite", satellites, true);
+        // PointToPointHelper().EnablePcap("scratch/P5-Satellite/out/satellite", satellites, true);
     }
 
     return satellites;
 }
 
+
+void Constellation::readTLEAndOrbits(std::string tleDataPath, std::string orbitsDataPath) {
+    // Read orbit data
+    OrbitCatalog orbitCatalog(orbitsDataPath);
+    NS_LOG_INFO("[+] Imported orbit data for " << orbitCatalog.records.size() << " orbits");
+
+    // Read TLE data
+    TLECatalog tleCatalog(tleDataPath);
+    this->tleEpoch = std::string(tleCatalog.epoch);
+
+    // For each satellite in the orbits, only grab those from the TLE data (filtering out the others)
+    this->TLEVector.clear();
+    this->OrbitVector.clear();
+    this->satelliteElements.clear();
+    this->OrbitVector.reserve(orbitCatalog.records.size());
+    uint32_t missingSatellites = 0;
+    for (const OrbitRecord& orbitRecord : orbitCatalog.records) {
+        Orbit orbit;
+        orbit.name = std::string(orbitRecord.name);
+        for (std::string_view name : orbitRecord.satellites) {
+            const TLERecord* tle = tleCatalog.find(name);
+            // Satellites without TLE data can not be placed, so they are left out of the orbit as well
+            if (tle == nullptr) {
+                NS_LOG_WARN("Satellite " << name << " of orbit " << orbit.name << " is not in the TLE data, skipping it");
+                missingSatellites++;
+                continue;
+            }
+            orbit.satellites.emplace_back(name);
+            this->TLEVector.push_back({std::string(tle->name), std::string(tle->line1), std::string(tle->line2)});
+            this->satelliteElements.push_back(tle->elements);
+        }
+        this->OrbitVector.push_back(std::move(orbit));
+    }
+    if (missingSatellites > 0) {
+        NS_LOG_WARN("[!] " << missingSatellites << " satellites in the orbit data are missing from the TLE data");
+    }
+}
+
+bool Constellation::loadConstellationCache(const std::string& cachePath, uint64_t cacheKey) {
+    ConstellationCache cache;
+    if (!cache.open(cachePath, cacheKey)) {
+        return false;
+    }
+
+    this->tleEpoch = std::string(cache.epoch());
+    this->TLEVector.clear();
+    this->TLEVector.reserve(cache.satelliteCount());
+    this->satelliteElements.clear();
+    this->satelliteElements.reserve(cache.satelliteCount());
+    for (uint32_t n = 0; n < cache.satelliteCount(); n++) {
+        this->TLEVector.push_back({std::string(cache.satelliteName(n)), std::string(cache.satelliteLine1(n)), std::string(cache.satelliteLine2(n))});
+        this->satelliteElements.push_back(cache.satelliteElements(n));
+    }
+
+    this->OrbitVector.clear();
+    this->OrbitVector.reserve(cache.orbitCount());
+    for (uint32_t n = 0; n < cache.orbitCount(); n++) {
+        Orbit orbit;
+        orbit.name = std::string(cache.orbitName(n));
+        uint32_t first = cache.orbitFirstSatellite(n);
+        for (uint32_t satIndex = first; satIndex < first + cache.orbitSatelliteCount(n); satIndex++) {
+            orbit.satellites.push_back(this->TLEVector[satIndex].name);
+        }
+        this->OrbitVector.push_back(std::move(orbit));
+    }
+    NS_LOG_INFO("[+] Loaded " << this->TLEVector.size() << " satellites in " << this->OrbitVector.size() << " orbits from the constellation cache");
+    return true;
+}
+
 NodeContainer Constellation::createGroundStations(std::vector<GeoCoordinate> groundStationsCoordinates) {
     
     NodeContainer groundStations(this->groundStationCount);
@@ -183,36 +271,22 @@ NodeContainer Constellation::createGroundStations(std::vector<GeoCoordinate> gro
     Ptr<RateErrorModel> error_model = CreateObject<RateErrorModel>();
     error_model->SetUnit(RateErrorModel::ERROR_UNIT_BIT);
     error_model->SetRate(gsSatPacketLossRate);
-    p2pHelper.SetDeviceAttribute("ReceiveErrorModel", PointerValue(error_model));
 
     // Groundstations have static IP addresses, therefore we simply assign them here and never remove the address from their interface
     Ipv4AddressHelper gsAddressHelper;
     gsAddressHelper.SetBase("1.0.0.0", "255.255.255.0");
 
-    Ptr<Node> dummyNode = CreateObject<Node>();
-    // Give it a constant mobility model to avoid warning in terminal
-    AnimationInterface::SetConstantPosition(dummyNode, -180, 90);
-
     // For each ground station, set up its mobility
     for (size_t n = 0; n < this->groundStationCount; ++n) {
-        // Create the single netdevice on each ground station
-        NetDeviceContainer gsNetDevice = p2pHelper.Install(NodeContainer(groundStations.Get(n), dummyNode) ).Get(0);
-        
+        // Create the single netdevice on each ground station, it is not connected to anything yet
+        Ptr<PointToPointNetDevice> gsNetDevice = this->createTerminal(groundStations.Get(n), this->gsToSatDataRate, error_model);
 
         // Assign an ip to the ground station but turn the interface down!
-        gsAddressHelper.Assign(gsNetDevice);
+        gsAddressHelper.Assign(NetDeviceContainer(gsNetDevice));
         groundStations.Get(n)->GetObject<Ipv4>()->SetDown(1);
         // Migrate to a new subnet for future ground stations
         gsAddressHelper.NewNetwork();
 
-        // Finally, attach to nullchannel as its not connected to anything
-        Ptr<PointToPointNetDevice> currP2PNetDevice = DynamicCast<PointToPointNetDevice>(gsNetDevice.Get(0));
-        Ptr<PointToPointChannel> nullChannel = CreateObject<PointToPointChannel>();
-        currP2PNetDevice->Attach(nullChannel);
-        gsNetDevice.Get(0)->GetChannel()->Dispose();
-        // Set the DataRate!
-        currP2PNetDevice->SetDataRate(this->gsToSatDataRate);
-
         // GroundStation mobility even though they dont move. The mobility models allows use of methods like .GetDistanceFrom(GS) etc.
         Ptr<SatConstantPositionMobilityModel> GSMobility = CreateObject<SatConstantPositionMobilityModel>();
         GSMobility->SetGeoPosition(groundStationsCoordinates[n]);
@@ -228,13 +302,16 @@ NodeContainer Constellation::createGroundStations(std::vector<GeoCoordinate> gro
 
 
 void Constellation::initializeSatIntraLinks() {
+    this->propagateConstellationState();
+
     // A counter used to keep track of the satellites ID
     uint32_t counter = 0;
+    SectorBatchScratch scratch;
     
     // For each orbit
     for (size_t i = 0; i < this->OrbitVector.size(); ++i) {
         NS_LOG_DEBUG("ORBIT " << i+1 << "/" << this->OrbitVector.size());
-        Orbit orbit = OrbitVector[i];
+        const Orbit& orbit = this->OrbitVector[i];
         
         // For each satellite in each orbit
         for (size_t j = 0; j < orbit.satellites.size(); ++j) {
@@ -244,6 +321,10 @@ void Constellation::initializeSatIntraLinks() {
             Ptr<Node> nextSatellite;
 
             counter++;
+            // The satellites after the last one created have no nodes
+            if (counter > this->satelliteCount) {
+                return;
+            }
 
             // If very last satellite in the orbit.
             if (j == orbit.satellites.size() - 1) {
@@ -255,44 +336,36 @@ void Constellation::initializeSatIntraLinks() {
                 nextSatellite = Names::Find<Node>(orbit.satellites[j+1]);
             }
 
-            // Extract mobility models for the nodes.
-            Ptr<SatSGP4MobilityModel> satMob = this->satelliteMobilityModels[satellite->GetId()];
-            Ptr<SatSGP4MobilityModel> nextSatMob = this->satelliteMobilityModels[nextSatellite->GetId()];
+            // Satellite node IDs are the same as their index in the constellation state
+            uint32_t satIndex = satellite->GetId();
+            uint32_t nextSatIndex = nextSatellite->GetId();
             
-            // For each combination of netdevices, check of link can be established
-            for (size_t n1 = 1; n1 <= 4; n1++){         // n1 for netDeviceIndex1
-                for (size_t n2 = 1; n2 <= 4; n2++) {     // n2 for netDeviceIndex2
-                    // skip impossible situations
-                    if (n1 == n2) {
-                        continue;
-                    }
-                    // If either if the NetDevices already have a connection, skip
-                    if ( hasExistingLink(satellite, n1) || hasExistingLink(nextSatellite, n2) ) {
-                        continue;
-                    }
-                    // Is the link possible according to angles, establish a connection
-                    if (satIsLinkValid(satMob, n1, nextSatMob, n2)) {
-                        double distance = satMob->GetDistanceFrom(nextSatMob);
-                        this->establishLink(satellite, n1, nextSatellite, n2, distance, SAT_SAT);
-
-                        // remove netDevices from availableNetDevs vector using satIndexes and the netdeviceIndex - 1
-                        int satIndex = satellite->GetId();
-                        for (uint32_t i = 0; i < this->availableSatNetDevices[satIndex].size(); i++) {   // loop through to find the relevant index to remove at
-                            if (this->availableSatNetDevices[satIndex][i] == (int)n1) {
-                                this->availableSatNetDevices[satIndex].erase(this->availableSatNetDevices[satIndex].begin() + i);
-                            }
-                        }
-                        // same procedure for both satellites
-                        int nextSatIndex = nextSatellite->GetId();
-                        for (uint32_t i = 0; i < this->availableSatNetDevices[nextSatIndex].size(); i++) {
-                            if (this->availableSatNetDevices[nextSatIndex][i] == (int)n2) {
-                                this->availableSatNetDevices[nextSatIndex].erase(this->availableSatNetDevices[nextSatIndex].begin() + i);
-                            }
-                        }
-                    }
-                }
-
+            // The netdevices the two satellites point at each other with are the only ones that can be linked
+            int netDevs[1];
+            int nextNetDevs[1];
+            getSectorsFromSatBatch(satIndex, &nextSatIndex, 1, this->state.x.data(), this->state.y.data(), this->state.z.data(),
+                                   this->srfBases, scratch, netDevs, nextNetDevs);
+            int n1 = netDevs[0];         // n1 for netDeviceIndex1
+            int n2 = nextNetDevs[0];     // n2 for netDeviceIndex2
+
+            // skip impossible situations
+            if (n1 == 0 || n2 == 0 || n1 == n2) {
+                continue;
+            }
+            // If either if the NetDevices already have a connection, skip
+            if ( hasExistingLink(satellite, n1) || hasExistingLink(nextSatellite, n2) ) {
+                continue;
             }
+            // Is the link possible according to distance, establish a connection
+            double distance = this->state.getDistance(satIndex, nextSatIndex);
+            if (distance > (this->maxSatToSatDistance * 1000)) {
+                continue;
+            }
+            this->establishLink(satellite, n1, nextSatellite, n2, distance, SAT_SAT);
+
+            // both netDevices are no longer available
+            this->takeTerminal(satIndex, n1);
+            this->takeTerminal(nextSatIndex, n2);
         }
     }
     NS_LOG_DEBUG("[!] INIT SAT LINKS DONE");
@@ -313,6 +386,145 @@ void Constellation::initializeSatIntraLinks() {
 
 
 
+void Constellation::setThreadCount(uint32_t threadCount) {
+    this->threadPool = std::make_unique<ThreadPool>(std::max<uint32_t>(threadCount, 1));
+    NS_LOG_INFO("[+] Updating the constellation with " << this->threadPool->getThreadCount() << " thread(s)");
+}
+
+
+void Constellation::setInterpolatedLinkDelay(bool enabled) {
+    this->interpolatedLinkDelay = enabled;
+}
+
+void Constellation::setEventDrivenLinks(bool enabled) {
+    this->eventDrivenLinks = enabled;
+    if (enabled) {
+        NS_LOG_INFO("[+] Link breaks are predicted from the ephemeris");
+    }
+}
+
+
+void Constellation::setHandoverPolicy(std::string policy) {
+    NS_ABORT_MSG_IF(policy != "first" && policy != "longest" && policy != "score", "Unknown handover policy " << policy);
+    if (policy == "longest") {
+        this->handoverPolicy = HANDOVER_LONGEST;
+    } else if (policy == "score") {
+        this->handoverPolicy = HANDOVER_SCORE;
+    } else {
+        this->handoverPolicy = HANDOVER_FIRST;
+    }
+}
+
+
+void Constellation::setTrackedFlows(std::string flows) {
+    this->routeRegistry->clearFlows();
+    std::istringstream list(flows);
+    std::string pair;
+    while (std::getline(list, pair, ',')) {
+        size_t dash = pair.find('-');
+        NS_ABORT_MSG_IF(dash == std::string::npos, "Tracked flow " << pair << " is not of the form src-dst");
+        uint32_t src = std::stoul(pair.substr(0, dash));
+        uint32_t dst = std::stoul(pair.substr(dash + 1));
+        NS_ABORT_MSG_IF(src >= this->groundStationNodes.GetN() || dst >= this->groundStationNodes.GetN() || src == dst,
+                        "Tracked flow " << pair << " does not connect two ground stations");
+        this->routeRegistry->addFlow(this->groundStationNodes.Get(src)->GetId(), this->groundStationNodes.Get(dst)->GetId());
+    }
+}
+
+void Constellation::printFlowStats() const {
+    uint32_t firstGs = this->groundStationNodes.Get(0)->GetId();
+    for (uint32_t flowId = 0; flowId < this->routeRegistry->getFlowCount(); flowId++) {
+        const RouteRegistry::Flow& flow = this->routeRegistry->getFlow(flowId);
+        std::ostringstream hops;
+        if (flow.maxHops > 0) {
+            hops << flow.minHops << "-" << flow.maxHops << " hops";
+        } else {
+            hops << "never routed";
+        }
+        NS_LOG_UNCOND("[+] Flow " << flowId << " (GS " << flow.srcNode - firstGs << " -> GS " << flow.dstNode - firstGs << "): "
+                      << flow.breaks << " route breaks, " << flow.pathChanges << " path length changes, " << hops.str());
+    }
+}
+
+void Constellation::printHandoverCounts() const {
+    uint32_t totalHandovers = 0;
+    for (uint32_t gsIndex = 0; gsIndex < this->gsLinkCount.size(); gsIndex++) {
+        uint32_t handovers = (this->gsLinkCount[gsIndex] > 0) ? this->gsLinkCount[gsIndex] - 1 : 0;
+        totalHandovers += handovers;
+        NS_LOG_UNCOND("[+] GS " << gsIndex << ": " << handovers << " handovers");
+    }
+    NS_LOG_UNCOND("[+] " << totalHandovers << " handovers in total");
+}
+
+void Constellation::setLinkAddressBlock(std::string block, uint16_t linkPrefixLength) {
+    size_t slash = block.find('/');
+    NS_ABORT_MSG_IF(slash == std::string::npos, "Link address block " << block << " is not of the form address/prefix");
+    std::string linkMask = "/" + std::to_string(linkPrefixLength);
+    this->linkAddresses.configure(Ipv4Address(block.substr(0, slash).c_str()), Ipv4Mask(block.substr(slash).c_str()),
+                                  Ipv4Mask(linkMask.c_str()));
+}
+
+void Constellation::printLinkAddressUsage() const {
+    NS_LOG_UNCOND("[+] At most " << this->linkAddresses.getPeakInUse() << " of " << this->linkAddresses.getCapacity()
+                  << " inter-satellite link subnets were in use at the same time");
+}
+
+void Constellation::printRoutingStats() const {
+    if (this->routingRecomputeCount == 0) {
+        return;
+    }
+    NS_LOG_UNCOND("[+] Routes recomputed " << this->routingRecomputeCount << " times, "
+                  << 1e3 * this->routingRecomputeSeconds / this->routingRecomputeCount << " ms on average, "
+                  << 1e3 * this->maxRoutingRecomputeSeconds << " ms at most");
+    if (this->routingGraph == nullptr) {
+        NS_LOG_UNCOND("[+] Global routing tables: " << this->globalRouteCount << " routes after the last update, "
+                      << this->maxGlobalRouteCount << " at most");
+    }
+}
+
+
+void Constellation::setRoutingMetric(std::string metric) {
+    NS_ABORT_MSG_IF(metric != "hops" && metric != "latency", "Unknown routing metric " << metric);
+    this->routingMetric = (metric == "latency") ? METRIC_LATENCY : METRIC_HOPS;
+}
+
+
+void Constellation::setRoutingMode(std::string mode) {
+    if (mode == "global") {
+        this->routingGraph = nullptr;
+        return;
+    }
+    NS_ABORT_MSG_IF(mode != "incremental" && mode != "gs", "Unknown routing mode " << mode);
+
+    this->routingGraph = Create<ConstellationRoutingGraph>(NodeList::GetNNodes());
+    // All traffic ends at the ground stations, so routes towards the inter-satellite subnets can be left out
+    bool gsOnly = (mode == "gs");
+    this->routingGraph->setRouteToLinkAddresses(!gsOnly);
+
+    // Put the protocol in front of the static and global routing already installed by the InternetStackHelper
+    NodeContainer nodes(this->satelliteNodes, this->groundStationNodes);
+    for (uint32_t n = 0; n < nodes.GetN(); n++) {
+        Ptr<Ipv4ListRouting> listRouting = DynamicCast<Ipv4ListRouting>(nodes.Get(n)->GetObject<Ipv4>()->GetRoutingProtocol());
+        NS_ABORT_MSG_IF(listRouting == nullptr, "Node " << n << " does not use Ipv4ListRouting");
+        Ptr<ConstellationRouting> routing = CreateObject<ConstellationRouting>();
+        routing->SetGraph(this->routingGraph);
+        listRouting->AddRoutingProtocol(routing, 10);
+    }
+
+    // Ground stations keep their address, so they can be found even before they have a link
+    for (uint32_t gsIndex = 0; gsIndex < this->groundStationNodes.GetN(); gsIndex++) {
+        Ptr<Node> gs = this->groundStationNodes.Get(gsIndex);
+        Ipv4InterfaceAddress gsAddress = gs->GetObject<Ipv4>()->GetAddress(1, 0);
+        if (gsOnly) {
+            this->routingGraph->addPrefix(gsAddress.GetLocal(), gsAddress.GetMask(), gs->GetId());
+        } else {
+            this->routingGraph->addHost(gsAddress.GetLocal(), gs->GetId());
+        }
+    }
+    NS_LOG_INFO("[+] Using " << mode << " constellation routing");
+}
+
+
 void Constellation::scheduleSimulation(int totalMinutes, int updateIntervalSeconds) {
     // Run simulation phase at i intervals
     int loops = int(60*totalMinutes / updateIntervalSeconds);
@@ -328,6 +540,18 @@ void Constellation::scheduleSimulation(int totalMinutes, int updateIntervalSecon
 
     NS_LOG_UNCOND("Node 18 -> " << Names::FindName(this->satelliteNodes.Get(18)));
 
+    if (this->contactPlanMode == PLAN_RECORD) {
+        this->contactPlan.satCount = this->satelliteCount;
+        this->contactPlan.gsCount = this->groundStationCount;
+        this->contactPlan.updateInterval = updateIntervalSeconds;
+        this->contactPlan.simTime = totalMinutes;
+    }
+
+    // Each update looks one interval ahead for the links that will break before the next update, and for the positions
+    // the link delays are interpolated from
+    if (this->eventDrivenLinks || this->interpolatedLinkDelay) {
+        this->createLookaheadMobilityModels(Seconds(updateIntervalSeconds));
+    }
 
     this->initializeSatIntraLinks();
     NS_LOG_INFO("[+] Initialized intra-plane links!");
@@ -339,25 +563,43 @@ void Constellation::scheduleSimulation(int totalMinutes, int updateIntervalSecon
         Time t = Seconds(i * updateIntervalSeconds);
         Simulator::Schedule(t, [this]() {
 
-            // TODO: save the current route before breaking any links.
-            this->saveCompleteRoute(this->groundStationNodes.Get(0), this->groundStationNodes.Get(1));
+            // Save the current routes before breaking any links
+            this->saveFlowRoutes();
             
             this->updateConstellation();
 
-            // TODO: clear current route before next time
-            this->currRoute.clear();
+            // The routes are recomputed during the update, so the saved ones are stale now
+            this->clearFlowRoutes();
         });
     }
 }
 
 void Constellation::updateConstellation() {
+    P5_PROFILE_TICK(Simulator::Now().GetSeconds());
     NS_LOG_INFO("\n\x1b[32;1m[+]\x1b[37m <" << Simulator::Now().GetSeconds() << "s> UPDATING CONSTELLATION\x1b[0m");
 
+    // Propagate all satellites once, every link validator reads from this snapshot during the update
+    this->propagateConstellationState();
+
     // Set the new positions of the satellites and update their position in NetAnimator.
-    for (uint32_t n = 0; n < this->satelliteNodes.GetN(); ++n) {
-        GeoCoordinate satPos = this->satelliteMobilityModels[n]->GetGeoPosition();
-        // latitude is inverted due to NetAnim growing the y-axis downward
-        AnimationInterface::SetConstantPosition(this->satelliteNodes.Get(n), satPos.GetLongitude(), -satPos.GetLatitude());
+    this->updateAnimationPositions();
+
+    if (this->eventDrivenLinks) {
+        // Links are broken by their predicted breaks, so only links without one have to be looked at again.
+        // Freed terminals are scanned when the break happens, so a scan is only needed here for the first links
+        // and for ground stations that are still without a link.
+        this->predictLinkBreaks();
+        bool gsWithoutLink = false;
+        for (uint32_t gsIndex = 0; gsIndex < this->groundStationNodes.GetN(); gsIndex++) {
+            gsWithoutLink |= !this->hasExistingLink(this->groundStationNodes.Get(gsIndex), 1);
+        }
+        if (this->firstTimeLinkEstablishing || gsWithoutLink) {
+            this->scanForNewLinks();
+        } else if (this->routingMetric == METRIC_LATENCY) {
+            // The topology did not change, but the links did get longer or shorter
+            this->recomputeRoutingTables();
+        }
+        return;
     }
 
     this->updateGroundStationLinks();
@@ -385,8 +627,7 @@ void Constellation::updateConstellation() {
     // NS-3 specifies that one should call PopulateRoutingTables() as the first thing, and only subsequently call RecomputeRoutingTables()
     // This does not seem to be a problem, so we ONLY use RecomputeRoutingTables without calling PopulateRoutingTables first!
     NS_LOG_DEBUG("Computing tables");
-    Ipv4GlobalRoutingHelper::RecomputeRoutingTables();
-    NS_LOG_INFO("[+] Routing tables computed");
+    this->recomputeRoutingTables();
     // POPULATE All satellites ARP tables :). THIS IS ONLY VALID FOR CSMA LINKS, NOT FOR POINT TO POINT
     // NeighborCacheHelper neighborCacheHelper;
     // neighborCacheHelper.PopulateNeighborCache();
@@ -394,21 +635,190 @@ void Constellation::updateConstellation() {
 }
 
 
+void Constellation::updateAnimationPositions() {
+    P5_PROFILE_SCOPE("animation");
+    for (uint32_t n = 0; n < this->satelliteNodes.GetN(); ++n) {
+        GeoCoordinate satPos = GeoCoordinate(this->state.getPosition(n));
+        // latitude is inverted due to NetAnim growing the y-axis downward
+        AnimationInterface::SetConstantPosition(this->satelliteNodes.Get(n), satPos.GetLongitude(), -satPos.GetLatitude());
+    }
+}
+
+
+void Constellation::recomputeRoutingTables() {
+    P5_PROFILE_SCOPE("routing");
+    if (this->contactPlanMode == PLAN_RECORD) {
+        // Record how far the links have moved regardless of the metric, such that the plan can be replayed with either
+        this->refreshLinkMetrics();
+        this->contactPlan.addRecord(ROUTE_UPDATE, 0, 0, 0, 0, 0, 0);
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (this->routingMetric == METRIC_LATENCY) {
+        this->refreshLinkMetrics();
+    }
+    if (this->routingGraph != nullptr) {
+        uint32_t changedNextHops = this->routingGraph->update();
+        NS_LOG_INFO("[+] Routing trees updated, " << changedNextHops << " next hops changed");
+    } else {
+        Ipv4GlobalRoutingHelper::RecomputeRoutingTables();
+        NS_LOG_INFO("[+] Routing tables computed");
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    this->routingRecomputeCount++;
+    this->routingRecomputeSeconds += seconds;
+    this->maxRoutingRecomputeSeconds = std::max(this->maxRoutingRecomputeSeconds, seconds);
+
+    if (this->routingGraph == nullptr) {
+        this->globalRouteCount = this->countGlobalRoutes();
+        this->maxGlobalRouteCount = std::max(this->maxGlobalRouteCount, this->globalRouteCount);
+    }
+}
+
+uint32_t Constellation::getLinkDelayUs(double distanceM) const {
+    return std::max<uint32_t>(1, std::lround(1e6 * distanceM / this->c));
+}
+
+void Constellation::refreshLinkMetrics() {
+    P5_PROFILE_SCOPE("link_metrics");
+    // A replayed plan carries the link lengths as LINK_UPDATE records, applied right before its ROUTE_UPDATE, so the
+    // geometry is not evaluated again
+    if (this->contactPlanMode == PLAN_REPLAY) {
+        return;
+    }
+    // Already current after an update, but the routes are also recomputed when a scheduled link comes up in between
+    this->propagateConstellationState();
+    uint32_t firstGsId = this->groundStationNodes.Get(0)->GetId();
+    uint32_t refreshed = 0;
+    for (uint32_t nodeId = 0; nodeId < this->satelliteCount; nodeId++) {
+        for (int terminal = 1; terminal < terminalsPerNode; terminal++) {
+            LinkState& link = this->getLinkState(nodeId, terminal);
+            // Every link has a satellite on at least one end, so starting from the satellites finds each link once
+            if (link.peer == NO_LINK || (link.peer < this->satelliteCount && link.peer < nodeId)) {
+                continue;
+            }
+            double distanceM = (link.peer < this->satelliteCount) ? this->state.getDistance(nodeId, link.peer)
+                                                                   : this->state.getGSDistance(link.peer - firstGsId, nodeId);
+            uint32_t delayUs = this->getLinkDelayUs(distanceM);
+            if (std::abs((double) delayUs - link.delayUs) <= this->metricChangeThreshold * link.delayUs) {
+                continue;
+            }
+            if (this->contactPlanMode == PLAN_RECORD) {
+                // Same node order as the LINK_UP record of the link
+                if (link.peer < this->satelliteCount) {
+                    this->contactPlan.addRecord(LINK_UPDATE, SAT_SAT, nodeId, terminal, link.peer, link.peerTerminal, distanceM);
+                } else {
+                    this->contactPlan.addRecord(LINK_UPDATE, GS_SAT, link.peer - firstGsId, link.peerTerminal, nodeId, terminal, distanceM);
+                }
+            }
+            this->setLinkDelay(nodeId, terminal, link.peer, link.peerTerminal, delayUs);
+            refreshed++;
+        }
+    }
+    NS_LOG_DEBUG("[+] Refreshed the metrics of " << refreshed << " links");
+}
+
+void Constellation::setLinkDelay(uint32_t node1, int node1NetDeviceIndex, uint32_t node2, int node2NetDeviceIndex, uint32_t delayUs) {
+    this->getLinkState(node1, node1NetDeviceIndex).delayUs = delayUs;
+    this->getLinkState(node2, node2NetDeviceIndex).delayUs = delayUs;
+    // Nothing is routed while recording a contact plan
+    if (this->contactPlanMode == PLAN_RECORD) {
+        return;
+    }
+    if (this->routingGraph != nullptr) {
+        this->routingGraph->setLinkWeight(node1, node1NetDeviceIndex, node2, node2NetDeviceIndex, delayUs);
+    } else {
+        this->setInterfaceMetrics(node1, node1NetDeviceIndex, node2, node2NetDeviceIndex, delayUs);
+    }
+}
+
+void Constellation::setInterfaceMetrics(uint32_t node1, int node1NetDeviceIndex, uint32_t node2, int node2NetDeviceIndex, uint32_t delayUs) {
+    uint16_t metric = std::min<uint32_t>(delayUs, UINT16_MAX);
+    NodeList::GetNode(node1)->GetObject<Ipv4>()->SetMetric(node1NetDeviceIndex, metric);
+    NodeList::GetNode(node2)->GetObject<Ipv4>()->SetMetric(node2NetDeviceIndex, metric);
+}
+
+uint64_t Constellation::countGlobalRoutes() const {
+    uint64_t routes = 0;
+    NodeContainer nodes(this->satelliteNodes, this->groundStationNodes);
+    for (uint32_t n = 0; n < nodes.GetN(); n++) {
+        Ptr<Ipv4ListRouting> listRouting = DynamicCast<Ipv4ListRouting>(nodes.Get(n)->GetObject<Ipv4>()->GetRoutingProtocol());
+        for (uint32_t i = 0; listRouting != nullptr && i < listRouting->GetNRoutingProtocols(); i++) {
+            int16_t priority;
+            Ptr<Ipv4GlobalRouting> globalRouting = DynamicCast<Ipv4GlobalRouting>(listRouting->GetRoutingProtocol(i, priority));
+            if (globalRouting != nullptr) {
+                routes += globalRouting->GetNRoutes();
+            }
+        }
+    }
+    return routes;
+}
+
+
+void Constellation::propagateConstellationState() {
+    P5_PROFILE_SCOPE("propagation");
+    if (this->state.isCurrent()) {
+        return;
+    }
+    if (this->eventDrivenLinks) {
+        // Move the prediction window forward once the simulation reaches its end. The end snapshot is reused as the
+        // start of the new window, so SGP4 is only run once per update for the lookahead models.
+        if (Simulator::Now() >= this->ephemeris->to.time) {
+            if (this->ephemeris->to.isCurrent()) {
+                std::swap(this->ephemeris->from, this->ephemeris->to);
+            } else {
+                this->ephemeris->from.propagate(this->satelliteMobilityModels, this->satelliteCount, *this->threadPool);
+            }
+            this->ephemeris->to.propagate(this->lookaheadMobilityModels, this->satelliteCount, *this->threadPool, this->lookaheadInterval);
+        }
+        this->state.interpolate(this->ephemeris->from, this->ephemeris->to, *this->threadPool);
+    } else {
+        this->state.propagate(this->satelliteMobilityModels, this->satelliteCount, *this->threadPool);
+        // Only the link delays use the window here. The link decisions keep the propagated positions, so they are the
+        // same as without interpolated delays.
+        if (!this->lookaheadMobilityModels.empty() && Simulator::Now() >= this->ephemeris->to.time) {
+            this->ephemeris->from = this->state;
+            this->ephemeris->to.propagate(this->lookaheadMobilityModels, this->satelliteCount, *this->threadPool, this->lookaheadInterval);
+        }
+    }
+
+    // Build the reference frame of every satellite once, instead of for every pair of satellites
+    this->srfBases.resize(this->satelliteCount);
+    this->threadPool->parallelFor(this->satelliteCount, [this](uint32_t begin, uint32_t end) {
+        this->srfBases.compute(this->state.x.data(), this->state.y.data(), this->state.z.data(),
+                               this->state.vx.data(), this->state.vy.data(), this->state.vz.data(), begin, end);
+    });
+}
+
+
 void Constellation::updateGroundStationLinks() {
+    P5_PROFILE_SCOPE("gs_links");
     // QUESTION: Technically, we want to break ALL invalid links before we start finding new links, right?!
 
-    for (uint32_t gsIndex = 0; gsIndex < this->groundStationNodes.GetN(); gsIndex++) {
+    // Pick a satellite for every ground station. Only the satellites within the coverage angle of a ground station are
+    // tested, in index order, so the "first" policy finds the same satellite as a scan over the whole constellation.
+    uint32_t gsCount = this->groundStationNodes.GetN();
+    this->visibilityIndex.build(this->state.x.data(), this->state.y.data(), this->state.z.data(), this->satelliteCount, this->visibilityCellDegrees);
+    std::vector<uint32_t> selectedSat(gsCount, this->satelliteCount);  // satelliteCount means that no satellite is visible
+    this->threadPool->parallelFor(gsCount, [this, &selectedSat](uint32_t begin, uint32_t end) {
+        std::vector<uint32_t> candidates;
+        for (uint32_t gsIndex = begin; gsIndex < end; gsIndex++) {
+            this->visibilityIndex.findCandidates(this->state.getGSPosition(gsIndex), this->gsCoverageAngle(gsIndex), candidates);
+            selectedSat[gsIndex] = this->selectGSSatellite(gsIndex, candidates);
+        }
+    });
+
+    // Commit the changes in ground station order
+    for (uint32_t gsIndex = 0; gsIndex < gsCount; gsIndex++) {
 
         Ptr<Node> gs = this->groundStationNodes.Get(gsIndex);
-        Ptr<SatConstantPositionMobilityModel> gsMobModel = this->groundStationsMobilityModels[gsIndex];
         bool linkFound = false;                 // keep track of if any GS which doesnt get a link. That is bad (but okay)
 
         if (this->hasExistingLink(gs, 1)) {                         // if GS has an existing link, get the connected satellite
-            Ptr<Node> connectedSat = this->getConnectedNetDev(gs, 1)->GetNode();      // get connected satellites mobility model
-            uint32_t satMobModelIndex = connectedSat->GetId();      // get the index of the satellite for use in the mobility model vector
-            Ptr<SatSGP4MobilityModel> satMobModel = this->satelliteMobilityModels[satMobModelIndex];
+            Ptr<Node> connectedSat = this->getConnectedNetDev(gs, 1)->GetNode();
+            uint32_t connectedSatIndex = connectedSat->GetId();      // get the index of the satellite in the constellation state
 
-            if (this->gsIsLinkValid(gsMobModel, satMobModel)) {   // check if the link is still valid
+            if (this->gsIsLinkValid(gsIndex, connectedSatIndex)) {   // check if the link is still valid
                 NS_LOG_DEBUG("[+] Link maintained between GS " << gsIndex << " and satellite index " << Names::FindName(connectedSat));
                 linkFound = true;
                 continue;                                   // if still valid, continue to next GS
@@ -419,21 +829,20 @@ void Constellation::updateGroundStationLinks() {
             }
         }
 
-        // Now loop through each satellite and try to establish a new link
-        for (uint32_t satIndex = 0; satIndex < this->satelliteNodes.GetN(); satIndex++) {
-            Ptr<Node> newSat = this->satelliteNodes.Get(satIndex);    // get the mobility model of the satellite, same procedure as above
-            uint32_t newSatMobModelIndex = newSat->GetId();
-            Ptr<SatSGP4MobilityModel> newSatMobModel = this->satelliteMobilityModels[newSatMobModelIndex];
-
-            if (this->gsIsLinkValid(gsMobModel, newSatMobModel)) {    // check if a link from GS to sat could work, if yes establish it and move to next GS
-                double distance = gsMobModel->GetDistanceFrom(newSatMobModel);
-                // Establish a GS_SAT link. GS NetDevice is always 1, while SAT NetDevice is always 5
-                establishLink(gs, 1, newSat, 5, distance, GS_SAT);
-                NS_LOG_DEBUG("Link established between GS " << gsIndex << " and satellite index " << Names::FindName(newSat));
-                linkFound = true;
-                // Since valid link is established, move on to next GS
-                break;
-            }
+        // Establish a link to the selected satellite. If an earlier ground station took its terminal in this loop, pick again.
+        uint32_t satIndex = selectedSat[gsIndex];
+        if (satIndex < this->satelliteCount && this->getLinkState(satIndex, 5).peer != NO_LINK) {
+            std::vector<uint32_t> candidates;
+            this->visibilityIndex.findCandidates(this->state.getGSPosition(gsIndex), this->gsCoverageAngle(gsIndex), candidates);
+            satIndex = this->selectGSSatellite(gsIndex, candidates);
+        }
+        if (satIndex < this->satelliteCount) {
+            Ptr<Node> newSat = this->satelliteNodes.Get(satIndex);
+            double distance = this->state.getGSDistance(gsIndex, satIndex);
+            // Establish a GS_SAT link. GS NetDevice is always 1, while SAT NetDevice is always 5
+            establishLink(gs, 1, newSat, 5, distance, GS_SAT);
+            NS_LOG_DEBUG("Link established between GS " << gsIndex << " and satellite index " << Names::FindName(newSat));
+            linkFound = true;
         }
         if (linkFound == false) {                               // display that we have a problem if this is true
             NS_LOG_INFO("[+] ERROR: GS " << gsIndex << " DID NOT GET A LINK!");
@@ -441,11 +850,64 @@ void Constellation::updateGroundStationLinks() {
     }
 }
 
-bool Constellation::gsIsLinkValid(Ptr<SatConstantPositionMobilityModel> GSMobModel, Ptr<SatSGP4MobilityModel>satMobModel) {
-    double distance = GSMobModel->GetDistanceFrom(satMobModel);     // in meters
+bool Constellation::gsIsLinkValid(uint32_t gsIndex, uint32_t satIndex) {
+    return this->gsIsLinkValid(this->state.getGSPosition(gsIndex), this->state.getPosition(satIndex));
+}
+
+uint32_t Constellation::selectGSSatellite(uint32_t gsIndex, const std::vector<uint32_t>& candidates) {
+    uint32_t bestSatIndex = this->satelliteCount;
+    double bestScore = -std::numeric_limits<double>::infinity();
+    for (uint32_t satIndex : candidates) {
+        // Satellites have a single ground station terminal, which might already be taken by another ground station
+        if (this->getLinkState(satIndex, 5).peer != NO_LINK || !this->gsIsLinkValid(gsIndex, satIndex)) {
+            continue;
+        }
+        if (this->handoverPolicy == HANDOVER_FIRST) {
+            return satIndex;
+        }
+        double window = this->estimateVisibilityWindow(gsIndex, satIndex);
+        double score = window;
+        if (this->handoverPolicy == HANDOVER_SCORE) {
+            double distance = this->state.getGSDistance(gsIndex, satIndex);
+            score = window / this->handoverHorizon - this->handoverDistanceWeight * distance / (this->maxGStoSatDistance * 1000);
+        }
+        // Ties go to the lowest index, same as the "first" policy
+        if (score > bestScore) {
+            bestScore = score;
+            bestSatIndex = satIndex;
+        }
+    }
+    return bestSatIndex;
+}
+
+double Constellation::estimateVisibilityWindow(uint32_t gsIndex, uint32_t satIndex) const {
+    Vector gsPos = this->state.getGSPosition(gsIndex);
+    Vector satPos = this->state.getPosition(satIndex);
+    Vector satVel = this->state.getVelocity(satIndex);
+    double breakTime = this->findBreakTime([this, gsPos, satPos, satVel](double dt) {
+        return this->gsIsLinkValid(gsPos, ConstellationState::extrapolateCircularOrbit(satPos, satVel, dt));
+    }, 0, this->handoverHorizon);
+    return (breakTime < 0) ? this->handoverHorizon : breakTime;
+}
+
+double Constellation::gsCoverageAngle(uint32_t gsIndex) const {
+    double gsRadius = this->state.getGSPosition(gsIndex).GetLength();
+    double elevation = this->minGSElevation * pi / 180;
+    double maxDistance = this->maxGStoSatDistance * 1000;
+
+    // Elevation limit: the horizon of the ground station tilted up by the elevation, where it meets the orbit of the
+    // highest satellite. Lower satellites drop below that limit sooner.
+    double elevationAngle = acos(std::min(1.0, gsRadius * cos(elevation) / this->visibilityIndex.getMaxRadius())) - elevation;
+    // Distance limit: the sub-satellite point is never further from the ground station than the satellite itself
+    double distanceAngle = acos(std::max(-1.0, 1 - (maxDistance * maxDistance) / (2 * gsRadius * gsRadius)));
+
+    // Small margin for rounding, the candidates are tested exactly afterwards
+    return std::min(elevationAngle, distanceAngle) + 1e-6;
+}
+
+bool Constellation::gsIsLinkValid(Vector gsPos, Vector satPos) const {
+    double distance = CalculateDistance(gsPos, satPos);     // in meters
     // calculate the angle between the GS and sat by extruding a triangle with the earths core in ECEF.
-    Vector satPos = satMobModel->GetPosition();             // get ECEF pos for sat
-    Vector gsPos = GSMobModel->GetPosition();               // also in ECEF
     double satPosMag = satPos.GetLength();                  // in meters
     double gsPosMag = gsPos.GetLength();                    // in meters
 
@@ -482,44 +944,103 @@ bool Constellation::gsIsLinkValid(Ptr<SatConstantPositionMobilityModel> GSMobMod
 
 
 bool Constellation::hasExistingLink(Ptr<Node> node, int netDevIndex) {
-    if (node->GetDevice(netDevIndex)->GetChannel()->GetNDevices() == 2) {
-        return true;
-    }
-    return false;
+    return this->getLinkState(node->GetId(), netDevIndex).peer != NO_LINK;
 }
 
 
 Ptr<NetDevice> Constellation::getConnectedNetDev(Ptr<Node> GSNode, int netDevIndex) {
-    // hold GS netdevice for reference
-    Ptr<NetDevice> localNetDevice = GSNode->GetDevice(netDevIndex);
-    for (int n=0; n < 2; n++) {
-        // Grab one of the NetDevices on the Channel
-        Ptr<NetDevice> foreignNetDevice = localNetDevice->GetChannel()->GetDevice(n);
-        // If that NetDevice is NOT your own, it must be the other node
-        if (localNetDevice != foreignNetDevice) {
-            return foreignNetDevice;
-        }
+    const LinkState& link = this->getLinkState(GSNode->GetId(), netDevIndex);
+    NS_ASSERT_MSG(link.peer != NO_LINK, "Node " << GSNode->GetId() << " has no link on netdevice " << netDevIndex);
+    return NodeList::GetNode(link.peer)->GetDevice(link.peerTerminal);
+}
+
+
+Constellation::LinkState& Constellation::getLinkState(uint32_t nodeId, int terminal) {
+    return this->linkTable[nodeId * terminalsPerNode + terminal];
+}
+
+
+const Constellation::LinkState& Constellation::getLinkState(uint32_t nodeId, int terminal) const {
+    return this->linkTable[nodeId * terminalsPerNode + terminal];
+}
+
+
+void Constellation::clearFlowRoutes() {
+    this->routeRegistry->clearPaths();
+}
+
+
+bool Constellation::isTerminalFree(uint32_t satIndex, int netDevIndex) const {
+    return this->freeTerminalMasks[satIndex] & (1 << netDevIndex);
+}
+
+
+void Constellation::takeTerminal(uint32_t satIndex, int netDevIndex) {
+    NS_ASSERT_MSG(this->isTerminalFree(satIndex, netDevIndex), "NetDevice " << netDevIndex << " of satellite " << satIndex << " is already taken");
+    this->freeTerminalMasks[satIndex] &= ~(1 << netDevIndex);
+    if (this->freeTerminalMasks[satIndex] == 0) {
+        // Swap the last satellite of the list into its place
+        uint32_t position = this->freeTerminalListPositions[satIndex];
+        uint32_t lastSatIndex = this->satsWithFreeTerminals.back();
+        this->satsWithFreeTerminals[position] = lastSatIndex;
+        this->freeTerminalListPositions[lastSatIndex] = position;
+        this->satsWithFreeTerminals.pop_back();
     }
-    return localNetDevice;  // never gets here, but this line makes the compiler happy
+}
+
+
+void Constellation::releaseTerminal(uint32_t satIndex, int netDevIndex) {
+    NS_ASSERT_MSG(!this->isTerminalFree(satIndex, netDevIndex), "NetDevice " << netDevIndex << " of satellite " << satIndex << " is already free");
+    if (this->freeTerminalMasks[satIndex] == 0) {
+        this->freeTerminalListPositions[satIndex] = this->satsWithFreeTerminals.size();
+        this->satsWithFreeTerminals.push_back(satIndex);
+    }
+    this->freeTerminalMasks[satIndex] |= 1 << netDevIndex;
+    this->terminalReleaseOrder[satIndex * terminalsPerNode + netDevIndex] = this->terminalReleaseCount++;
+}
+
+
+Ptr<PointToPointNetDevice> Constellation::createTerminal(Ptr<Node> node, DataRate dataRate, Ptr<ErrorModel> errorModel) {
+    Ptr<PointToPointNetDevice> device = CreateObject<PointToPointNetDevice>();
+    device->SetAddress(Mac48Address::Allocate());
+    device->SetDataRate(dataRate);
+    device->SetReceiveErrorModel(errorModel);
+    node->AddDevice(device);
+
+    Ptr<Queue<Packet>> queue = CreateObject<DropTailQueue<Packet>>();
+    device->SetQueue(queue);
+    // Flow control, same as PointToPointHelper does by default
+    Ptr<NetDeviceQueueInterface> queueInterface = CreateObject<NetDeviceQueueInterface>();
+    queueInterface->GetTxQueue(0)->ConnectQueueTraces(queue);
+    device->AggregateObject(queueInterface);
+
+    device->Attach(CreateObject<SatLinkChannel>());
+    return device;
+}
+
+Ptr<SatLinkChannel> Constellation::getTerminalChannel(Ptr<Node> node, int netDevIndex) const {
+    return DynamicCast<SatLinkChannel>(node->GetDevice(netDevIndex)->GetChannel());
 }
 
 
 void Constellation::establishLink(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<Node> node2, int node2NetDeviceIndex, double distanceM, LinkType linkType) {
+    P5_PROFILE_SCOPE("establish_link");
     // check if any indexes are out of bounds. GS's must be handled seperately
     if (node1NetDeviceIndex > 5 || node2NetDeviceIndex > 5) {
         NS_LOG_ERROR("Index out of bounds in establishLink");
         return;
     }
 
-    Ptr<PointToPointChannel> channel = CreateObject<PointToPointChannel>();
-    double channelDelay = distanceM / c;  // seconds
-    channel->SetAttribute("Delay", TimeValue( Seconds(channelDelay) ));
+    Time channelDelay = Seconds(distanceM / c);
+    uint32_t delayUs = this->getLinkDelayUs(distanceM);
+    double weight = (this->routingMetric == METRIC_LATENCY) ? delayUs : 1;
     
     Ptr<Ipv4> ipv4_1 = node1->GetObject<Ipv4>();
     Ptr<Ipv4> ipv4_2 = node2->GetObject<Ipv4>();
     ipv4_1->SetUp(node1NetDeviceIndex);
     ipv4_2->SetUp(node2NetDeviceIndex);
-    
+    this->journal->record(EVENT_LINK_UP, (linkType == GS_SAT) ? "GS_SAT" : "SAT_SAT", node1->GetId(), node1NetDeviceIndex,
+                          node2->GetId(), node2NetDeviceIndex, distanceM);
 
     if (linkType == GS_SAT) {
         // Get IP address of ground station
@@ -535,18 +1056,33 @@ void Constellation::establishLink(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<
         Ipv4InterfaceAddress satNewAddr = Ipv4InterfaceAddress(satNewIP, Ipv4Mask("255.255.255.0"));
         ipv4_2->AddAddress(node2NetDeviceIndex, satNewAddr);
 
+        uint32_t gsIndex = this->getContactPlanIndex(node1, GS_SAT);
+        this->gsLinkCount[gsIndex]++;
+        if (this->gsPreviousSatellite[gsIndex] != NO_LINK) {
+            this->journal->record(EVENT_HANDOVER, "GS_SAT", node1->GetId(), node1NetDeviceIndex, node2->GetId(), node2NetDeviceIndex,
+                                  this->gsPreviousSatellite[gsIndex]);
+        }
+
+        if (this->routingGraph != nullptr) {
+            this->routingGraph->addLink(node1->GetId(), node1NetDeviceIndex, gsIP, node2->GetId(), node2NetDeviceIndex, satNewIP, weight);
+        }
+
         NS_LOG_DEBUG("Groundstation current IP: " << gsIP << " -> New Satellite IP: " << satNewIP);
 
         //channel->SetAttribute("DataRate", this->gsToSatDataRate);
     }
     else if (linkType == SAT_SAT) { // Is link is being  established
-        std::pair<Ipv4Address, Ipv4Address> addressPair = getLinkAddressPair();
+        std::pair<Ipv4Address, Ipv4Address> addressPair = this->linkAddresses.allocate();
 
-        Ipv4InterfaceAddress satNewAddr0 = Ipv4InterfaceAddress(addressPair.first, Ipv4Mask("255.255.255.0"));
-        Ipv4InterfaceAddress satNewAddr1 = Ipv4InterfaceAddress(addressPair.second, Ipv4Mask("255.255.255.0"));
+        Ipv4InterfaceAddress satNewAddr0 = Ipv4InterfaceAddress(addressPair.first, this->linkAddresses.getSubnetMask());
+        Ipv4InterfaceAddress satNewAddr1 = Ipv4InterfaceAddress(addressPair.second, this->linkAddresses.getSubnetMask());
         ipv4_1->AddAddress(node1NetDeviceIndex, satNewAddr0);
         ipv4_2->AddAddress(node2NetDeviceIndex, satNewAddr1);
 
+        if (this->routingGraph != nullptr) {
+            this->routingGraph->addLink(node1->GetId(), node1NetDeviceIndex, addressPair.first, node2->GetId(), node2NetDeviceIndex, addressPair.second, weight);
+        }
+
         NS_LOG_DEBUG("      " << Names::FindName(node1) << " IP: " << satNewAddr0.GetAddress() << " <--> "  << Names::FindName(node2) << " IP: " << satNewAddr1.GetAddress());
 
 
@@ -557,17 +1093,42 @@ void Constellation::establishLink(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<
 
         //channel->SetAttribute("DataRate", this->satToSatDataRate);
     }
-    // Dispose of the null channels!
-    DynamicCast<PointToPointNetDevice>(node1->GetDevice(node1NetDeviceIndex))->GetChannel()->Dispose();
-    DynamicCast<PointToPointNetDevice>(node2->GetDevice(node2NetDeviceIndex))->GetChannel()->Dispose();
+    // Connect the channels of both netdevices to each other, one for each direction
+    Ptr<PointToPointNetDevice> p2pNetDevice1 = DynamicCast<PointToPointNetDevice>(node1->GetDevice(node1NetDeviceIndex));
+    Ptr<PointToPointNetDevice> p2pNetDevice2 = DynamicCast<PointToPointNetDevice>(node2->GetDevice(node2NetDeviceIndex));
+    Ptr<SatLinkChannel> channel1 = this->getTerminalChannel(node1, node1NetDeviceIndex);
+    Ptr<SatLinkChannel> channel2 = this->getTerminalChannel(node2, node2NetDeviceIndex);
+    channel1->Connect(p2pNetDevice2, channelDelay);
+    channel2->Connect(p2pNetDevice1, channelDelay);
+    if (this->interpolatedLinkDelay && !this->lookaheadMobilityModels.empty()) {
+        SatLinkChannel::LinkEnd end1 = {node1->GetId(), Vector()};
+        if (linkType == GS_SAT) {
+            end1 = {SatLinkChannel::FIXED_END, this->state.getGSPosition(this->getContactPlanIndex(node1, GS_SAT))};
+        }
+        SatLinkChannel::LinkEnd end2 = {node2->GetId(), Vector()};
+        channel1->TrackDistance(this->ephemeris, end1, end2);
+        channel2->TrackDistance(this->ephemeris, end2, end1);
+    }
+
+    uint32_t linkId = this->nextLinkId++;
+    this->getLinkState(node1->GetId(), node1NetDeviceIndex) = {node2->GetId(), node2NetDeviceIndex, linkId, Simulator::Now(), delayUs};
+    this->getLinkState(node2->GetId(), node2NetDeviceIndex) = {node1->GetId(), node1NetDeviceIndex, linkId, Simulator::Now(), delayUs};
+    if (this->routingMetric == METRIC_LATENCY && this->routingGraph == nullptr) {
+        this->setInterfaceMetrics(node1->GetId(), node1NetDeviceIndex, node2->GetId(), node2NetDeviceIndex, delayUs);
+    }
 
-    // Attach nodes to the same P2P channel.
-    DynamicCast<PointToPointNetDevice>(node1->GetDevice(node1NetDeviceIndex))->Attach(channel);
-    DynamicCast<PointToPointNetDevice>(node2->GetDevice(node2NetDeviceIndex))->Attach(channel);
+    if (this->contactPlanMode == PLAN_RECORD) {
+        this->contactPlan.addRecord(LINK_UP, linkType, this->getContactPlanIndex(node1, linkType), node1NetDeviceIndex,
+                                    node2->GetId(), node2NetDeviceIndex, distanceM);
+    }
+    if (this->eventDrivenLinks) {
+        this->predictLinkBreak(node1, node1NetDeviceIndex, node2, node2NetDeviceIndex, linkType);
+    }
 }
 
 
 void Constellation::destroyLink(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<Node> node2, int node2NetDeviceIndex, LinkType linkType) {
+    P5_PROFILE_SCOPE("destroy_link");
     // In this function we assume that there is a link to actually destroy!
 
     if (node1NetDeviceIndex > 5) {  // check if any indexes are out of bounds. GS's netDeviceIndex is always 1.
@@ -575,38 +1136,32 @@ void Constellation::destroyLink(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<No
         return;
     }
 
-    // check if the route has been broken
-    bool broken = false;
-    std::pair<Ptr<Node>, int> node1Pair = {node1, node1NetDeviceIndex};
-    std::pair<Ptr<Node>, int> node2Pair = {node2, node2NetDeviceIndex};
-    for (const auto& pair : this->currRoute) {
-        if ( (pair.first == node1Pair.first && pair.second == node1Pair.second) || (pair.first == node2Pair.first && pair.second == node2Pair.second) ) {
-            broken = true;
-            NS_LOG_INFO("ROUTE BROKEN BETWEEN NODES " << Names::FindName(node1) << " - " << Names::FindName(node2) << "");
-            break;
-        }
+    if (this->contactPlanMode == PLAN_RECORD) {
+        this->contactPlan.addRecord(LINK_DOWN, linkType, this->getContactPlanIndex(node1, linkType), node1NetDeviceIndex,
+                                    node2->GetId(), node2NetDeviceIndex, 0);
     }
 
-    // save break to file
-    if (broken) {
-        // Get the current simulator time in seconds
-        double currentTime = Simulator::Now().GetSeconds();
+    if (this->routingGraph != nullptr) {
+        this->routingGraph->removeLink(node1->GetId(), node1NetDeviceIndex, node2->GetId(), node2NetDeviceIndex);
+    }
 
-        // Construct the file name using the satCount
-        std::ostringstream fileName;
-        fileName << "scratch/P5-Satellite/out/link_break_times_satCount" << this->satelliteCount << ".log";
+    // A link destroyed before its predicted break must not be broken again later
+    this->cancelLinkBreak(node1, node1NetDeviceIndex);
+    this->cancelLinkBreak(node2, node2NetDeviceIndex);
 
-        // Open the file in append mode
-        std::ofstream outFile(fileName.str(), std::ios::app);
-        if (outFile.is_open()) {
-            // Write the current time to the file
-            outFile << currentTime << "," << std::endl;
-            outFile.close();
-        } else {
-            NS_LOG_ERROR("Failed to open file: " << fileName.str());
-        }
+    // Both ends of a link are on the saved path of a flow using it, so looking up one end is enough
+    const char* linkName = (linkType == GS_SAT) ? "GS_SAT" : "SAT_SAT";
+    for (uint32_t flowId : this->routeRegistry->linkBroken(node1->GetId(), node1NetDeviceIndex)) {
+        NS_LOG_INFO("ROUTE OF FLOW " << flowId << " BROKEN BETWEEN NODES " << Names::FindName(node1) << " - " << Names::FindName(node2) << "");
+        this->journal->record(EVENT_ROUTE_BREAK, linkName, node1->GetId(), node1NetDeviceIndex, node2->GetId(), node2NetDeviceIndex, flowId);
     }
+    this->getLinkState(node1->GetId(), node1NetDeviceIndex) = {NO_LINK, 0, 0, Seconds(0), 0};
+    this->getLinkState(node2->GetId(), node2NetDeviceIndex) = {NO_LINK, 0, 0, Seconds(0), 0};
 
+    this->journal->record(EVENT_LINK_DOWN, linkName, node1->GetId(), node1NetDeviceIndex, node2->GetId(), node2NetDeviceIndex);
+    if (linkType == GS_SAT) {
+        this->gsPreviousSatellite[this->getContactPlanIndex(node1, GS_SAT)] = node2->GetId();
+    }
 
     // Get neccessary pointers for the local node
     Ptr<NetDevice> netDev_1 = node1->GetDevice(node1NetDeviceIndex);
@@ -619,20 +1174,15 @@ void Constellation::destroyLink(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<No
     ipv4_1->SetDown( node1NetDeviceIndex );
     ipv4_2->SetDown( node2NetDeviceIndex );
 
-    // Get the channel and dispose of it, freeing the memory, allegedly.
-    node1->GetDevice(node1NetDeviceIndex)->GetChannel()->Dispose();
-    
-    // create new local NullChannels for each netDevice
-    Ptr<PointToPointChannel> nullChannel1 = CreateObject<PointToPointChannel>();
-    Ptr<PointToPointChannel> nullChannel2 = CreateObject<PointToPointChannel>();
-    DynamicCast<PointToPointNetDevice>( node1->GetDevice(node1NetDeviceIndex) )->Attach(nullChannel1);
-    DynamicCast<PointToPointNetDevice>( node2->GetDevice(node2NetDeviceIndex) )->Attach(nullChannel2);
+    // The channels stay attached to their netdevices, ready for the next link
+    this->getTerminalChannel(node1, node1NetDeviceIndex)->Disconnect();
+    this->getTerminalChannel(node2, node2NetDeviceIndex)->Disconnect();
 
     // If GS_SAT, only remoove the SAT IP. If SAT_SAT, remove both their 
     if (linkType == GS_SAT) {
         ipv4_2->RemoveAddress(node2NetDeviceIndex, 0);  // TODO: yet again, we assume that netdevice Indexes are same as IPv4 indexes
     } else if (linkType == SAT_SAT) {
-        releaseLinkAddressPair(ipv4_1->GetAddress(node1NetDeviceIndex, 0).GetAddress(), ipv4_2->GetAddress(node2NetDeviceIndex, 0).GetAddress());
+        this->linkAddresses.release(ipv4_1->GetAddress(node1NetDeviceIndex, 0).GetAddress());
         ipv4_1->RemoveAddress(node1NetDeviceIndex, 0);  // TODO: yet again, we assume that netdevice Indexes are same as IPv4 indexes
         ipv4_2->RemoveAddress(node2NetDeviceIndex, 0);  // TODO: yet again, we assume that
     }
@@ -640,260 +1190,514 @@ void Constellation::destroyLink(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<No
     return;
 }
 
-// Get an address subnet pair for an inter satellite link.
-std::pair<Ipv4Address, Ipv4Address> Constellation::getLinkAddressPair() {
+bool Constellation::satIsLinkValid(uint32_t satIndex, int netDeviceIndex, uint32_t connSatIndex, int connNetDeviceIndex) {
+    return this->satIsLinkValid(this->state.getPosition(satIndex), this->state.getVelocity(satIndex), netDeviceIndex,
+                                this->state.getPosition(connSatIndex), this->state.getVelocity(connSatIndex), connNetDeviceIndex);
+}
 
-    // Link address pair to return.
-    std::pair<Ipv4Address, Ipv4Address> linkPair;
+bool Constellation::satIsLinkValid(Vector satPos, Vector satVel, int netDeviceIndex, Vector connSatPos, Vector connSatVel, int connNetDeviceIndex) const {
 
-    // If this is zero, we generate a new address pair.
-    if (this->linkAddressProvider.size() == 0) {
+    // Check that the satellite is in range.
+    double distance = CalculateDistance(satPos, connSatPos);
+    if ( distance > (this->maxSatToSatDistance * 1000) ) {
+        return false;       // return early if we get here
+    }
 
-        Ipv4Address address = Ipv4Address("0.0.0.1");
-        uint8_t addr[4] = {0, 0, 0, 1};
-        address.Serialize(addr);
+    // The link is only valid if both satellites point at each other with exactly the netdevices given
+    std::pair<double, double> angles = getAngleFromSatPair(satPos, satVel, connSatPos, connSatVel);
+    return getSectorFromAngle(angles.first) == netDeviceIndex && getSectorFromAngle(angles.second) == connNetDeviceIndex;
+}
 
-        // Set the new address, starting at 2.0.0.1
-        // Similiar to SetBase(Ipv4Address("2.0.0.0"), Ipv4Mask("255.255.255.0"));
-        addr[0] = 2+floor(this->linkSubnetCounter/(256*256));
-        addr[1] = floor(this->linkSubnetCounter/256);
-        addr[2] = 1+this->linkSubnetCounter;
 
-        // Increment the subnet counter so we do not reuse a subnet.
-        // TODO, should this also the the case with addr[3] and addr[4]???
-        if (addr[2] == 253) {   // Skip the .254 and .255 subnets as they are broadcast addresses
-            this->linkSubnetCounter += 3; 
-        } else {
-            this->linkSubnetCounter++;
+void Constellation::updateSatelliteLinks() {
+    P5_PROFILE_SCOPE("sat_links");
+
+    // keep track of amount of broken sat-sat links, maintained sat-sat links and established sat-sat links in each simulation round
+    int linksBroken = 0;
+    int linksMaintained = 0;
+    int linksEstablished = 0;
+
+    NS_LOG_DEBUG("[+] updateSatelliteLinks() -----------");
+
+    // ============ Link maintenance ============
+    std::vector<ExistingSatLink> existingLinks = this->collectExistingSatLinks();
+
+    // Check if the links are still valid in parallel
+    this->threadPool->parallelFor(existingLinks.size(), [this, &existingLinks](uint32_t begin, uint32_t end) {
+        for (uint32_t n = begin; n < end; n++) {
+            ExistingSatLink& link = existingLinks[n];
+            link.valid = this->satIsLinkValid(link.satIndex, link.netDevIndex, link.connSatIndex, link.connNetDevIndex);
         }
-        
-        // Convert the address bytes to an Ipv4Address
-        linkPair.first = address.Deserialize(addr);
-        addr[3]++;
-        linkPair.second = address.Deserialize(addr);
+    });
+
+    // Maintain or BREAK the links in the same order as they were collected
+    for (const ExistingSatLink& link : existingLinks) {
+        Ptr<Node> satNode = this->satelliteNodes.Get(link.satIndex);
+        // The link might already have been broken from the other satellite's side
+        if (!this->hasExistingLink(satNode, link.netDevIndex)) {
+            continue;
+        }
+        Ptr<Node> connSatNode = this->satelliteNodes.Get(link.connSatIndex);
 
-        return linkPair;
+        if (link.valid) {
+            // NS_LOG_DEBUG("Link maintained satellites <" << Names::FindName(satNode) << "> - <" << Names::FindName(connSatNode) << ">");
+            linksMaintained++;
+        }
+        else {
+            NS_LOG_DEBUG("Link BROKEN between satellites <" << Names::FindName(satNode) << "> - <" << Names::FindName(connSatNode) << ">");
+            destroyLink(satNode, link.netDevIndex, connSatNode, link.connNetDevIndex, SAT_SAT);
+            NS_LOG_DEBUG("  used netDevs: " << link.netDevIndex << ", " << link.connNetDevIndex);
+            NS_LOG_DEBUG("  First satellite " << satNode->GetId() << " second satellite " << connSatNode->GetId());
+
+            linksBroken++;
+
+            // Both netdevices are now available again
+            this->releaseTerminal(link.satIndex, link.netDevIndex);
+            this->releaseTerminal(link.connSatIndex, link.connNetDevIndex);
+        }
     }
 
-    // Logical else 
 
-    // Get link pair from the linkAddressProvider, and dequeue that link pair.
-    linkPair = linkAddressProvider.front();
-    linkAddressProvider.pop();
+    linksEstablished = this->establishSatelliteLinks();
 
-    return linkPair;
+    NS_LOG_INFO("Maintained " << linksMaintained << " links - Broke " << linksBroken << " links - Established " << linksEstablished << " links");
 }
 
-void Constellation::releaseLinkAddressPair(Ipv4Address linkAddress_0, Ipv4Address linkAddress_1) {
-    // Construct link address pair
-    std::pair<Ipv4Address, Ipv4Address> linkAddressPair;
-    linkAddressPair.first = linkAddress_0;
-    linkAddressPair.second = linkAddress_1;
 
-    // Reclaim the link address.
-    this->linkAddressProvider.push(linkAddressPair);
+std::vector<Constellation::ExistingSatLink> Constellation::collectExistingSatLinks() {
+    std::vector<ExistingSatLink> existingLinks;
+    for (uint32_t i = 0; i < this->satelliteCount; i++) {
+        // Satellite node IDs are the same as their index
+        for (int netDevIndex = 1; netDevIndex <= 4; netDevIndex++) {
+            const LinkState& link = this->getLinkState(i, netDevIndex);
+            if (link.peer != NO_LINK) {
+                existingLinks.push_back({i, netDevIndex, link.peer, link.peerTerminal, false});
+            }
+        }
+    }
+    return existingLinks;
 }
 
 
+int Constellation::establishSatelliteLinks() {
+    int linksEstablished = 0;
 
+    // ============ Link establishment ============
+    // Bucket the satellites into a grid with cells as large as the max link distance. Satellites further away can never
+    // pass satIsLinkValid(), so each satellite only has to look at the neighbours the grid gives it.
+    std::vector<Vector> satPositions;
+    satPositions.reserve(this->satelliteCount);
+    for (uint32_t i = 0; i < this->satelliteCount; i++) {
+        satPositions.emplace_back(this->state.getPosition(i));
+    }
+    this->satelliteGrid.build(satPositions, this->maxSatToSatDistance * 1000);
+
+    // Only satellites with a free netdevice can get a new link. They are visited in ascending order, same as a full scan.
+    // NetDevices are only taken from here on, never freed, so no other satellite becomes interesting during this function.
+    std::vector<uint32_t> freeSats(this->satsWithFreeTerminals);
+    std::sort(freeSats.begin(), freeSats.end());
+
+    // Score the candidates of every satellite in parallel. A pair of satellites can only ever link with the two netdevices
+    // pointing at each other, so only pairs where both of those are free are kept. They are ordered the way the full scan
+    // tried them: by the order the netdevices were freed in, then by the other satellite.
+    this->linkCandidates.resize(this->satelliteCount);
+    this->threadPool->parallelFor(freeSats.size(), [this, &freeSats](uint32_t begin, uint32_t end) {
+        std::vector<uint32_t> neighbours;
+        std::vector<int> netDevs, connNetDevs;
+        SectorBatchScratch scratch;
+        for (uint32_t n = begin; n < end; n++) {
+            uint32_t satIndex = freeSats[n];
+            this->linkCandidates[satIndex].clear();
+            this->satelliteGrid.findNeighbours(satIndex, this->maxSatToSatDistance * 1000, neighbours);
+            // Satellites without any free netdevices can not be linked to
+            neighbours.erase(std::remove_if(neighbours.begin(), neighbours.end(), [this](uint32_t connSatIndex) {
+                return this->freeTerminalMasks[connSatIndex] == 0;
+            }), neighbours.end());
+
+            // Find the netdevices of all the pairs in one go
+            netDevs.resize(neighbours.size());
+            connNetDevs.resize(neighbours.size());
+            getSectorsFromSatBatch(satIndex, neighbours.data(), neighbours.size(), this->state.x.data(), this->state.y.data(), this->state.z.data(),
+                                   this->srfBases, scratch, netDevs.data(), connNetDevs.data());
+
+            for (uint32_t i = 0; i < neighbours.size(); i++) {
+                if (this->isTerminalFree(satIndex, netDevs[i]) && this->isTerminalFree(neighbours[i], connNetDevs[i])) {
+                    this->linkCandidates[satIndex].push_back({neighbours[i], netDevs[i], connNetDevs[i], this->state.getDistance(satIndex, neighbours[i])});
+                }
+            }
+            const uint64_t* releaseOrder = &this->terminalReleaseOrder[satIndex * terminalsPerNode];
+            std::stable_sort(this->linkCandidates[satIndex].begin(), this->linkCandidates[satIndex].end(),
+                             [releaseOrder](const LinkCandidate& a, const LinkCandidate& b) {
+                return releaseOrder[a.netDevIndex] < releaseOrder[b.netDevIndex];
+            });
+        }
+    });
 
-bool Constellation::satIsLinkValid(Ptr<SatSGP4MobilityModel> mobilityModel, int netDeviceIndex, Ptr<SatSGP4MobilityModel> connMobilityModel, int connNetDeviceIndex) {
-    
-    // Check that the satellite is in range.
-    double distance = mobilityModel->GetDistanceFrom(connMobilityModel);
-    if ( distance > (this->maxSatToSatDistance * 1000) ) {
-        return false;       // return early if we get here
+    // Commit the links serially, satellite by satellite and netdevice by netdevice, in the same order as the full scan
+    // would make them. The link IDs and the subnets given out by the address allocator are therefore the same as well.
+    for (uint32_t satIndex : freeSats) {   // lop through sats
+
+        // get node for this satellite
+        Ptr<Node> satNode = this->satelliteNodes.Get(satIndex);
+
+        // loop through the candidates of each netdevice in ascending order of the other satellite. Each netdevice links to
+        // the first candidate for it, as 2 sats will never be able to connect more netDevices anyway (angles)
+        for (const LinkCandidate& candidate : this->linkCandidates[satIndex]) {
+            // Check that neither netdevice has been taken since the candidates were scored
+            if (!this->isTerminalFree(satIndex, candidate.netDevIndex) || !this->isTerminalFree(candidate.connSatIndex, candidate.connNetDevIndex)) {
+                continue;
+            }
+
+            // get node for this satellite
+            int satFreeNetDev = candidate.netDevIndex;
+            uint32_t connSatIndex = candidate.connSatIndex;
+            Ptr<Node> connSatNode = this->satelliteNodes.Get(connSatIndex);
+            int connSatFreeNetDev = candidate.connNetDevIndex;
+            double distance = candidate.distance;
+
+            // If link is valid, create a link and remove both netDevices from the available netdevices
+            NS_LOG_DEBUG("[+] Creating new sat link connection between sat [ " << Names::FindName(satNode) << " ].netDev[ " << satFreeNetDev << " ] and sat [ " << Names::FindName(connSatNode) << " ].netDev[ " << connSatFreeNetDev << " ]   COORDS: " << GeoCoordinate(this->state.getPosition(satIndex)));
+
+
+            // Avoid scheduled link acquisition time during first link establishment
+            if (firstTimeLinkEstablishing) {
+                this->establishLink(satNode, satFreeNetDev, connSatNode, connSatFreeNetDev, distance, SAT_SAT);
+            } else {
+                // Establish the new link, but take into account the link acquisition time.
+                // This will schedule the link establish at --> Time.Now() + linkAcquisitionTime
+                Simulator::Schedule(this->linkAcquisitionTime.Get(), [this, satNode, satFreeNetDev, connSatNode, connSatFreeNetDev, distance](){
+                    // NS_LOG_DEBUG("[!!!] <" << Simulator::Now().GetSeconds() << "s> Scheduled establish link!");
+                    this->establishLink(satNode, satFreeNetDev, connSatNode, connSatFreeNetDev, distance, SAT_SAT);
+                    // Without polling there is no next update to pick the new link up, so the routes are updated right away
+                    if (this->eventDrivenLinks) {
+                        this->recomputeRoutingTables();
+                    }
+                });
+            }
+
+            linksEstablished++;
+            this->takeTerminal(satIndex, satFreeNetDev);
+            this->takeTerminal(connSatIndex, connSatFreeNetDev);
+        }
     }
-    
-    // get angle from sat1 to sat2 and the other way around
-    std::pair<double, double> angles = getAngleFromSatPair(mobilityModel, connMobilityModel);   // angles.first is sat1 to sat2. Angles.second is the otwer way around
-    if (angles.first < -45) {
-        angles.first = abs(angles.first);
-        angles.first = 360 - angles.first;
+    // Once we have done it the first time, disable it for the next time!
+    firstTimeLinkEstablishing = false;
+
+    return linksEstablished;
+}
+
+
+
+
+
+void Constellation::createLookaheadMobilityModels(Time interval) {
+    this->lookaheadInterval = interval;
+
+    // Shift the start date of the models by the interval, such that they are that far ahead of the simulation time
+    std::tm epoch = {};
+    std::istringstream epochStream(this->tleEpoch);
+    epochStream >> std::get_time(&epoch, "%Y-%m-%d %H:%M:%S");
+    NS_ASSERT_MSG(!epochStream.fail(), "Could not parse the TLE epoch '" << this->tleEpoch << "'");
+    std::time_t lookaheadEpoch = timegm(&epoch) + static_cast<std::time_t>(interval.GetSeconds());
+    std::tm lookaheadTm = {};
+    gmtime_r(&lookaheadEpoch, &lookaheadTm);
+    std::ostringstream lookaheadDate;
+    lookaheadDate << std::put_time(&lookaheadTm, "%Y-%m-%d %H:%M:%S");
+
+    this->lookaheadMobilityModels.clear();
+    for (uint32_t n = 0; n < this->satelliteCount; ++n) {
+        Ptr<SatSGP4MobilityModel> satMobility = CreateObject<SatSGP4MobilityModel>();
+        satMobility->SetTleInfo(this->TLEVector[n].line1 + "\n" + this->TLEVector[n].line2);
+        satMobility->SetStartDate(lookaheadDate.str());
+        this->lookaheadMobilityModels.emplace_back(satMobility);
     }
+    NS_LOG_INFO("[+] Lookahead mobility models start at " << lookaheadDate.str());
+}
+
 
-    if (angles.second < -45) {
-        angles.second = abs(angles.second);
-        angles.second = 360 - angles.second;
+void Constellation::predictLinkBreaks() {
+    P5_PROFILE_SCOPE("predict_breaks");
+    this->propagateConstellationState();
+    double start = Simulator::Now().GetSeconds();
+    double end = this->ephemeris->to.time.GetSeconds();
+
+    // Ground station links are few, so they are simply done one at a time
+    for (uint32_t gsIndex = 0; gsIndex < this->groundStationNodes.GetN(); gsIndex++) {
+        Ptr<Node> gs = this->groundStationNodes.Get(gsIndex);
+        if (!this->hasExistingLink(gs, 1) || this->scheduledLinkBreaks.count({gs->GetId(), 1})) {
+            continue;
+        }
+        Ptr<Node> connectedSat = this->getConnectedNetDev(gs, 1)->GetNode();
+        double breakTime = this->findGSLinkBreakTime(gsIndex, connectedSat->GetId(), start, end);
+        if (breakTime >= 0) {
+            this->scheduleLinkBreak(gs, 1, connectedSat, 5, GS_SAT, breakTime);
+        }
     }
-    // NS_LOG_DEBUG("PAIR: " << angles.first << " | " << angles.second);
-    
-    // first check for sat1. Check negative cases and stop early if true
-    if (!(angles.first >= NetDeviceAngles[netDeviceIndex - 1].minAngle) || !(angles.first < NetDeviceAngles[netDeviceIndex - 1].maxAngle)) {
-        return false;        // return early if we get here
+
+    // Every sat-sat link is seen from both sides, so only keep it once, and only if its break is not known yet
+    std::vector<ExistingSatLink> links = this->collectExistingSatLinks();
+    links.erase(std::remove_if(links.begin(), links.end(), [this](const ExistingSatLink& link) {
+        return link.connSatIndex < link.satIndex || this->scheduledLinkBreaks.count({link.satIndex, link.netDevIndex});
+    }), links.end());
+
+    std::vector<double> breakTimes(links.size());
+    this->threadPool->parallelFor(links.size(), [this, &links, &breakTimes, start, end](uint32_t begin, uint32_t last) {
+        for (uint32_t n = begin; n < last; n++) {
+            const ExistingSatLink& link = links[n];
+            breakTimes[n] = this->findSatLinkBreakTime(link.satIndex, link.netDevIndex, link.connSatIndex, link.connNetDevIndex, start, end);
+        }
+    });
+
+    int breaksScheduled = 0;
+    for (uint32_t n = 0; n < links.size(); n++) {
+        if (breakTimes[n] >= 0) {
+            const ExistingSatLink& link = links[n];
+            this->scheduleLinkBreak(this->satelliteNodes.Get(link.satIndex), link.netDevIndex,
+                                    this->satelliteNodes.Get(link.connSatIndex), link.connNetDevIndex, SAT_SAT, breakTimes[n]);
+            breaksScheduled++;
+        }
     }
+    NS_LOG_INFO("Checked " << links.size() << " links - Predicted " << breaksScheduled << " breaks before " << end << "s");
+}
+
 
-    // then check for sat2
-    if (!(angles.second >= NetDeviceAngles[connNetDeviceIndex - 1].minAngle) || !(angles.second < NetDeviceAngles[connNetDeviceIndex - 1].maxAngle)) {
-        return false;        // return early if we get here
+void Constellation::predictLinkBreak(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<Node> node2, int node2NetDeviceIndex, LinkType linkType) {
+    this->propagateConstellationState();
+    double start = Simulator::Now().GetSeconds();
+    double end = this->ephemeris->to.time.GetSeconds();
+
+    double breakTime;
+    if (linkType == GS_SAT) {
+        // Ground stations are created right after each other, so their index follows from the node ID
+        uint32_t gsIndex = node1->GetId() - this->groundStationNodes.Get(0)->GetId();
+        breakTime = this->findGSLinkBreakTime(gsIndex, node2->GetId(), start, end);
+    } else {
+        breakTime = this->findSatLinkBreakTime(node1->GetId(), node1NetDeviceIndex, node2->GetId(), node2NetDeviceIndex, start, end);
     }
+    if (breakTime >= 0) {
+        this->scheduleLinkBreak(node1, node1NetDeviceIndex, node2, node2NetDeviceIndex, linkType, breakTime);
+    }
+}
 
-    // if both checks passed, the link is valid
-    return true;
+
+double Constellation::findBreakTime(const std::function<bool(double)>& isValidAt, double start, double end) const {
+    if (end <= start) {
+        return -1;
+    }
+    double step = (end - start) / this->breakSearchSteps;
+    double validTime = start;
+    for (uint32_t n = 1; n <= this->breakSearchSteps; n++) {
+        double sampleTime = (n == this->breakSearchSteps) ? end : start + n * step;
+        if (isValidAt(sampleTime)) {
+            validTime = sampleTime;
+            continue;
+        }
+        // The link breaks somewhere between the last valid sample and this one
+        double invalidTime = sampleTime;
+        while (invalidTime - validTime > this->breakTimeResolution) {
+            double midTime = 0.5 * (validTime + invalidTime);
+            if (isValidAt(midTime)) {
+                validTime = midTime;
+            } else {
+                invalidTime = midTime;
+            }
+        }
+        return invalidTime;
+    }
+    return -1;
 }
 
 
+double Constellation::findGSLinkBreakTime(uint32_t gsIndex, uint32_t satIndex, double start, double end) const {
+    Vector gsPos = this->state.getGSPosition(gsIndex);
+    return this->findBreakTime([this, gsPos, satIndex](double time) {
+        Vector satPos, satVel;
+        ConstellationState::interpolateSatellite(this->ephemeris->from, this->ephemeris->to, satIndex, time, satPos, satVel);
+        return this->gsIsLinkValid(gsPos, satPos);
+    }, start, end);
+}
 
-void Constellation::updateSatelliteLinks() {
 
-    // keep track of amount of broken sat-sat links, maintained sat-sat links and established sat-sat links in each simulation round
-    int linksBroken = 0;
-    int linksMaintained = 0;
-    int linksEstablished = 0;
+double Constellation::findSatLinkBreakTime(uint32_t satIndex, int netDeviceIndex, uint32_t connSatIndex, int connNetDeviceIndex, double start, double end) const {
+    return this->findBreakTime([this, satIndex, netDeviceIndex, connSatIndex, connNetDeviceIndex](double time) {
+        Vector satPos, satVel, connSatPos, connSatVel;
+        ConstellationState::interpolateSatellite(this->ephemeris->from, this->ephemeris->to, satIndex, time, satPos, satVel);
+        ConstellationState::interpolateSatellite(this->ephemeris->from, this->ephemeris->to, connSatIndex, time, connSatPos, connSatVel);
+        return this->satIsLinkValid(satPos, satVel, netDeviceIndex, connSatPos, connSatVel, connNetDeviceIndex);
+    }, start, end);
+}
 
-    NS_LOG_DEBUG("[+] updateSatelliteLinks() -----------");
-    // Iterate over each satellite
-    for (uint32_t i = 0; i < this->satelliteCount; i++) {
 
-        // Get the node and sat mobility model
-        Ptr<Node> satNode = this->satelliteNodes.Get(i);
-        Ptr<SatSGP4MobilityModel> satMobModel = this->satelliteMobilityModels[i];
-        
-        // Iterate over each satellites NetDevices' connection. Maintain it, or BREAK it if needed
-        for (int netDevIndex = 1; netDevIndex <= 4; netDevIndex++) {
+void Constellation::scheduleLinkBreak(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<Node> node2, int node2NetDeviceIndex, LinkType linkType, double breakTime) {
+    Time delay = Seconds(breakTime) - Simulator::Now();
+    if (delay < Seconds(0)) {
+        delay = Seconds(0);     // rounding of the current time to seconds and back
+    }
+    EventId breakEvent = Simulator::Schedule(delay, &Constellation::breakPredictedLink, this, node1, node1NetDeviceIndex, node2, node2NetDeviceIndex, linkType);
+    this->scheduledLinkBreaks[{node1->GetId(), node1NetDeviceIndex}] = breakEvent;
+    this->scheduledLinkBreaks[{node2->GetId(), node2NetDeviceIndex}] = breakEvent;
+}
 
-            // Check if there is an already existing link
-            if (this->hasExistingLink(satNode, netDevIndex)) {
-                Ptr<NetDevice> connNetDev = this->getConnectedNetDev(satNode, netDevIndex);
-                Ptr<Node> connSatNode = connNetDev->GetNode();
-                Ptr<SatSGP4MobilityModel> connSatMobModel = this->satelliteMobilityModels[connSatNode->GetId()];
-                
-                // actual warcrime but it works so keep it or live with the consequences of your actions, bling bling brr brr skyat
-                uint32_t ipv4InterfaceIndex = connSatNode->GetObject<Ipv4>()->GetInterfaceForDevice(connNetDev);
-                uint32_t connNetDevIndex = ipv4InterfaceIndex;      // We know that IPv4 and netDev index are always the same
-                
-                if (this->satIsLinkValid(satMobModel, netDevIndex, connSatMobModel, connNetDevIndex)) {
-                    // NS_LOG_DEBUG("Link maintained satellites <" << Names::FindName(satNode) << "> - <" << Names::FindName(connSatNode) << ">");
-                    linksMaintained++;
-                    continue;       // move on ot next netdevice for this satellite
-                }
-                else {
-                    NS_LOG_DEBUG("Link BROKEN between satellites <" << Names::FindName(satNode) << "> - <" << Names::FindName(connSatNode) << ">");
-                    destroyLink(satNode, netDevIndex, connSatNode, connNetDevIndex, SAT_SAT);
-                    NS_LOG_DEBUG("  used netDevs: " << netDevIndex << ", " << connNetDevIndex);
-                    NS_LOG_DEBUG("  First satellite " << satNode->GetId() << " second satellite " << connSatNode->GetId());
 
-                    linksBroken++;
+void Constellation::cancelLinkBreak(Ptr<Node> node, int netDevIndex) {
+    auto scheduledBreak = this->scheduledLinkBreaks.find({node->GetId(), netDevIndex});
+    if (scheduledBreak != this->scheduledLinkBreaks.end()) {
+        scheduledBreak->second.Cancel();
+        this->scheduledLinkBreaks.erase(scheduledBreak);
+    }
+}
 
-                    // remove netDevices from availableNetDevs vector using satIndexes and the netdeviceIndex - 1
-                    int satIndex = satNode->GetId();
-                    this->availableSatNetDevices[satIndex].emplace_back(netDevIndex);
 
-                    // same procedure for both satellites
-                    int connSatIndex = connSatNode->GetId();
-                    this->availableSatNetDevices[connSatIndex].emplace_back(connNetDevIndex);
+void Constellation::breakPredictedLink(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<Node> node2, int node2NetDeviceIndex, LinkType linkType) {
+    NS_LOG_DEBUG("[+] <" << Simulator::Now().GetSeconds() << "s> Predicted break between " << Names::FindName(node1) << " and " << Names::FindName(node2));
 
+    // Same as at every update in the polling mode, such that route breaks are logged at the exact break time
+    this->saveFlowRoutes();
+    this->destroyLink(node1, node1NetDeviceIndex, node2, node2NetDeviceIndex, linkType);
+    this->clearFlowRoutes();
 
-                    // NS_LOG_DEBUG("new available list for sat1: ");
-                    // for (uint32_t n = 0; n < this->availableSatNetDevices[satIndex].size(); n++) {
-                    //     NS_LOG_DEBUG(n << " = " << this->availableSatNetDevices[satIndex][n]);
-                    // }
+    if (linkType == SAT_SAT) {
+        this->releaseTerminal(node1->GetId(), node1NetDeviceIndex);
+        this->releaseTerminal(node2->GetId(), node2NetDeviceIndex);
+    }
+    this->scheduleLinkScan();
+}
 
-                    // NS_LOG_DEBUG("new available list for sat2: ");
-                    // for (uint32_t n = 0; n < this->availableSatNetDevices[connSatIndex].size(); n++) {
-                    //     NS_LOG_DEBUG(n << " = " << this->availableSatNetDevices[connSatIndex][n]);
-                    // }
 
-                }
+void Constellation::scheduleLinkScan() {
+    if (this->linkScanScheduled) {
+        return;
+    }
+    this->linkScanScheduled = true;
+    // Runs after every other event at the current time, so all breaks happening now are handled by the same scan
+    Simulator::ScheduleNow(&Constellation::scanForNewLinks, this);
+}
 
-            }
-        }
+
+void Constellation::scanForNewLinks() {
+    P5_PROFILE_SCOPE("scan_links");
+    this->linkScanScheduled = false;
+    this->propagateConstellationState();
+
+    this->updateGroundStationLinks();
+    int linksEstablished = this->establishSatelliteLinks();
+    NS_LOG_INFO("<" << Simulator::Now().GetSeconds() << "s> Established " << linksEstablished << " links");
+
+    this->recomputeRoutingTables();
+}
+
+
+void Constellation::recordContactPlan() {
+    this->contactPlanMode = PLAN_RECORD;
+    NS_LOG_INFO("[+] Recording a contact plan, routes are not computed");
+}
+
+
+void Constellation::saveContactPlan(std::string path) {
+    this->contactPlan.write(path);
+    NS_LOG_INFO("[+] Saved contact plan with " << this->contactPlan.records.size() << " records to " << path);
+}
+
+
+uint32_t Constellation::getContactPlanIndex(Ptr<Node> node1, LinkType linkType) {
+    if (linkType == GS_SAT) {
+        // Ground stations are created right after each other, so their index follows from the node ID
+        return node1->GetId() - this->groundStationNodes.Get(0)->GetId();
     }
-    
+    return node1->GetId();
+}
 
-    // keep track of which indecies to remove from the sat in the outermost loop. 
-    // They canonly be removed AFTER checks for the sats netdevices are all done.
-    std::vector<int> netDevIndeciesToRemove = {};
-    // link establishment
-    for (uint32_t satIndex = 0; satIndex < this->availableSatNetDevices.size(); ++satIndex) {   // lop through sats
 
-        // get node and mobilityModel for this satellite
-        Ptr<Node> satNode = this->satelliteNodes.Get(satIndex);
-        Ptr<SatSGP4MobilityModel> satMobModel = this->satelliteMobilityModels[satIndex];
+void Constellation::scheduleContactPlanReplay(std::string path) {
+    this->contactPlanMode = PLAN_REPLAY;
+    // Breaks are part of the plan, so they must not be predicted again
+    this->eventDrivenLinks = false;
+    this->contactPlan.read(path);
+    NS_ABORT_MSG_IF(this->contactPlan.satCount != this->satelliteCount || this->contactPlan.gsCount != this->groundStationCount,
+                    "Contact plan " << path << " is for " << this->contactPlan.satCount << " satellites and " << this->contactPlan.gsCount
+                    << " ground stations, but the constellation has " << this->satelliteCount << " and " << this->groundStationCount);
+    NS_LOG_INFO("[+] Replaying " << this->contactPlan.records.size() << " contact plan records over " << this->contactPlan.simTime << " minutes");
+    if (this->routingMetric == METRIC_LATENCY && !this->contactPlan.hasLinkUpdates()) {
+        NS_LOG_WARN("[!] Contact plan " << path << " predates LINK_UPDATE records, links keep the latency they were established with");
+    }
 
-        for (uint32_t netDevIndex = 0; netDevIndex < this->availableSatNetDevices[satIndex].size(); ++netDevIndex) {    // loo through sat's netDevices
-            
-            bool connected = false;     // keep track o if this netdevice gets a connection
+    // Show the satellites at their starting positions
+    this->propagateConstellationState();
+    this->updateAnimationPositions();
+
+    // Apply the records in batches of the same time. Those at time 0 are applied right away, just like the first update
+    const std::vector<ContactRecord>& records = this->contactPlan.records;
+    size_t begin = 0;
+    while (begin < records.size()) {
+        size_t end = begin + 1;
+        while (end < records.size() && records[end].timeNs == records[begin].timeNs) {
+            end++;
+        }
+        if (records[begin].timeNs == 0) {
+            this->applyContactRecords(begin, end);
+        } else {
+            Simulator::Schedule(NanoSeconds(records[begin].timeNs), &Constellation::applyContactRecords, this, begin, end);
+        }
+        begin = end;
+    }
+}
 
-            for (uint32_t connSatIndex = 0; connSatIndex < this->availableSatNetDevices.size(); ++connSatIndex) {   // loop through potential sats to connect to
-                if (connSatIndex == satIndex) {
-                    // Skip so we do not select net devices on the same satellite.
-                    continue;
-                }
 
-                // get node and mobilityModel for this satellite
-                Ptr<Node> connSatNode = this->satelliteNodes.Get(connSatIndex);
-                Ptr<SatSGP4MobilityModel> connSatMobModel = this->satelliteMobilityModels[connSatIndex];
-
-                // loop through "potential sat to connect to"'s netdevices
-                for (uint32_t connNetDevIndex = 0; connNetDevIndex < this->availableSatNetDevices[connSatIndex].size(); ++connNetDevIndex) {
-                    
-                    int satFreeNetDev = availableSatNetDevices[satIndex][netDevIndex];
-                    int connSatFreeNetDev = availableSatNetDevices[connSatIndex][connNetDevIndex];
-                    
-                    if (this->satIsLinkValid(satMobModel, satFreeNetDev, connSatMobModel, connSatFreeNetDev)) {
-                        
-                        // If link is valid, create a link and remove both netDevices from the available vector
-                        double distance = satMobModel->GetDistanceFrom(connSatMobModel);
-                        // NS_LOG_UNCOND("Coordinates of sat1 with new link: " << satMobModel->GetPosition());
-                        NS_LOG_DEBUG("[+] Creating new sat link connection between sat [ " << Names::FindName(satNode) << " ].netDev[ " << satFreeNetDev << " ] and sat [ " << Names::FindName(connSatNode) << " ].netDev[ " << connSatFreeNetDev << " ]   COORDS: " << satMobModel->GetGeoPosition());
-                        
-
-                        // Avoid scheduled link acquisition time during first link establishment
-                        if (firstTimeLinkEstablishing) {
-                            this->establishLink(satNode, satFreeNetDev, connSatNode, connSatFreeNetDev, distance, SAT_SAT);
-                        } else {
-                            // Establish the new link, but take into account the link acquisition time.
-                            // This will schedule the link establish at --> Time.Now() + linkAcquisitionTime
-                            Simulator::Schedule(this->linkAcquisitionTime.Get(), [this, satNode, satFreeNetDev, connSatNode, connSatFreeNetDev, distance](){
-                                // NS_LOG_DEBUG("[!!!] <" << Simulator::Now().GetSeconds() << "s> Scheduled establish link!");
-                                this->establishLink(satNode, satFreeNetDev, connSatNode, connSatFreeNetDev, distance, SAT_SAT);
-                            });
-                        }
-
-                        connected = true;   // tell the 2 loop that the netdevice now has a connection
-                        linksEstablished++;
-
-                        // remove the now taken connNetDevice. We wait with removing the satNode's netDev, so that we dont get indexing errors
-                        for (uint32_t i = 0; i < this->availableSatNetDevices[connSatIndex].size(); i++) {   // loop through to find the relevant index to remove at
-                            if (this->availableSatNetDevices[connSatIndex][i] == (int)connSatFreeNetDev) {
-                                this->availableSatNetDevices[connSatIndex].erase(this->availableSatNetDevices[connSatIndex].begin() + i);
-                            }
-                        }
-                        break;  // after removing, break loop since 2 sats will never be able to connect more netDevices anyway (angles)
-                    }
-                }
+void Constellation::applyContactRecords(size_t begin, size_t end) {
+    const std::vector<ContactRecord>& records = this->contactPlan.records;
 
-                if (connected) {
-                    break;
-                }
-            }
+    // Save the route before links are broken, such that route breaks are logged the same way as in a normal run
+    bool breaksLinks = false;
+    for (size_t n = begin; n < end; n++) {
+        breaksLinks |= records[n].type == LINK_DOWN;
+    }
+    if (breaksLinks) {
+        this->saveFlowRoutes();
+    }
 
-            if (connected) {
-                netDevIndeciesToRemove.emplace_back(netDevIndex);
-                continue;       // continue to sat's next netdevice and try to find a link for that one
-            }
+    for (size_t n = begin; n < end; n++) {
+        const ContactRecord& record = records[n];
+        if (record.type == ROUTE_UPDATE) {
+            this->recomputeRoutingTables();
+            continue;
         }
-        // loop through to find the relevant index to remove at
-        for (uint32_t i = 0; i < netDevIndeciesToRemove.size(); i++) {
-            // -i is added as without it we will remove the wrong indicies as we change the vector's size during the for loop.
-            // This problem only arises if a satellite has multiple free netdevices and more than 1 of them gets a link in a single run of this function.
-            this->availableSatNetDevices[satIndex].erase(this->availableSatNetDevices[satIndex].begin() + netDevIndeciesToRemove[i] - i);
+        LinkType linkType = static_cast<LinkType>(record.linkType);
+        Ptr<Node> node1 = (linkType == GS_SAT) ? this->groundStationNodes.Get(record.node1) : this->satelliteNodes.Get(record.node1);
+        Ptr<Node> node2 = this->satelliteNodes.Get(record.node2);
+        if (record.type == LINK_UPDATE) {
+            // Only the latency metric needs the length of a link after it was established
+            if (this->routingMetric == METRIC_LATENCY) {
+                this->setLinkDelay(node1->GetId(), record.node1NetDevice, node2->GetId(), record.node2NetDevice,
+                                   this->getLinkDelayUs(record.distance));
+            }
+        } else if (record.type == LINK_UP) {
+            this->establishLink(node1, record.node1NetDevice, node2, record.node2NetDevice, record.distance, linkType);
+        } else {
+            this->destroyLink(node1, record.node1NetDevice, node2, record.node2NetDevice, linkType);
         }
-        netDevIndeciesToRemove.clear();
     }
-    // Once we have done it the first time, disable it for the next time!
-    firstTimeLinkEstablishing = false;
 
-    NS_LOG_INFO("Maintained " << linksMaintained << " links - Broke " << linksBroken << " links - Established " << linksEstablished << " links");
+    if (breaksLinks) {
+        this->clearFlowRoutes();
+    }
 }
 
 
+void Constellation::saveFlowRoutes() {
+    P5_PROFILE_SCOPE("save_route");
+    // Nothing is routed while recording a contact plan
+    if (this->contactPlanMode == PLAN_RECORD) {
+        return;
+    }
+    for (uint32_t flowId = 0; flowId < this->routeRegistry->getFlowCount(); flowId++) {
+        const RouteRegistry::Flow& flow = this->routeRegistry->getFlow(flowId);
+        this->routeRegistry->setPath(flowId, this->traceRoute(NodeList::GetNode(flow.srcNode), NodeList::GetNode(flow.dstNode)));
+    }
+}
 
 
-
-void Constellation::saveCompleteRoute(Ptr<Node> srcNode, Ptr<Node> dstNode){
-    NS_LOG_INFO("[!] Route testing (from node " << srcNode->GetId() << " to node " << dstNode->GetId() << ")");
+std::vector<RouteHop> Constellation::traceRoute(Ptr<Node> srcNode, Ptr<Node> dstNode) {
+    NS_LOG_LOGIC("[!] Route testing (from node " << srcNode->GetId() << " to node " << dstNode->GetId() << ")");
 
     Ipv4Header header;
     header.SetDestination( dstNode->GetObject<Ipv4>()->GetAddress(1, 0).GetAddress() );
@@ -901,44 +1705,34 @@ void Constellation::saveCompleteRoute(Ptr<Node> srcNode, Ptr<Node> dstNode){
     header.SetProtocol( TcpL4Protocol::PROT_NUMBER );
     Socket::SocketErrno errnoOut = Socket::ERROR_NOTERROR;
 
-
     // Start at the source node and get the next hop node based on the routing table
     // The next hop is the gateway, which is found by continously using the IP of the destination node
     // When gateway is found, this becomes the new source node. Repeat until at destination
+    std::vector<RouteHop> hops;
     Ptr<Node> currentNode = srcNode;
     while (true) {
         Ptr<Ipv4Route> route = currentNode->GetObject<Ipv4>()->GetRoutingProtocol()->RouteOutput(nullptr, header, 0, errnoOut);
-        int32_t interfaceOut = currentNode->GetObject<Ipv4>()->GetInterfaceForDevice( route->GetOutputDevice() );
-
-        Ptr<NetDevice> localNetDevice = currentNode->GetDevice(interfaceOut);
-        Ptr<NetDevice> foreignNetDevice = getConnectedNetDev(currentNode, interfaceOut);
-        // for (int n = 0; n < 2; n++) {
-        //     Ptr<NetDevice> tmpDevice = localNetDevice->GetChannel()->GetDevice(n);
-        //     if (localNetDevice != tmpDevice)
-        //         foreignNetDevice = tmpDevice;
-        // }
-        Ptr<Node> foreignNode = foreignNetDevice->GetNode();
-        // NS_LOG_INFO("Forwarding from " << Names::FindName(currentNode) << "(" << interfaceOut << ") --> " << Names::FindName(foreignNode) << "(" << foreignNode->GetObject<Ipv4>()->GetInterfaceForDevice(foreignNetDevice) << ") at " << route->GetGateway());
-        
-        // save states here to the vector
-        std::pair<Ptr<Node>, int> currPair = {currentNode, interfaceOut};
-        std::pair<Ptr<Node>, int> nextPair = {foreignNode, foreignNode->GetObject<Ipv4>()->GetInterfaceForDevice(foreignNetDevice)};
-        this->currRoute.emplace_back(currPair);
-        this->currRoute.emplace_back(nextPair);
-
-        if (foreignNode == dstNode)
+        if (route == nullptr) {
+            // A ground station without a satellite, or a part of the constellation cut off from the destination
+            NS_LOG_LOGIC("No route from node " << currentNode->GetId() << " to node " << dstNode->GetId());
+            return {};
+        }
+        // Netdevice and interface indexes are the same
+        int interfaceOut = route->GetOutputDevice()->GetIfIndex();
+        const LinkState& link = this->getLinkState(currentNode->GetId(), interfaceOut);
+        NS_ASSERT_MSG(link.peer != NO_LINK, "Route leaves node " << currentNode->GetId() << " on netdevice " << interfaceOut << " without a link");
+        hops.emplace_back(currentNode->GetId(), interfaceOut);
+        hops.emplace_back(link.peer, link.peerTerminal);
+
+        if (link.peer == dstNode->GetId())
             break;
+        // A route can not visit more links than there are nodes, unless it loops
+        if (hops.size() > 2 * NodeList::GetNNodes()) {
+            NS_LOG_WARN("Route from node " << srcNode->GetId() << " to node " << dstNode->GetId() << " loops");
+            return {};
+        }
 
-        currentNode = foreignNode;
+        currentNode = NodeList::GetNode(link.peer);
     }
-
-    // // print route vector here
-    // NS_LOG_INFO("Printing contents of currRoute:");
-    // for (const auto& pair : this->currRoute) {
-    //     Ptr<Node> node = pair.first;
-    //     int netDevice = pair.second;
-    //     NS_LOG_INFO("Node name: " << Names::FindName(node) << " - NetDevice: " << netDevice);
-    // }
-
-
+    return hops;
 }
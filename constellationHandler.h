@@ -10,7 +10,21 @@
 #include "ns3/point-to-point-module.h"
 
 #include "tleHandler.h"
+#include "constellationCache.h"
 #include "SRFMath.h"
+#include "spatialIndex.h"
+#include "constellationState.h"
+#include "threadPool.h"
+#include "contactPlan.h"
+#include "constellationRouting.h"
+#include "satLinkChannel.h"
+#include "linkAddressAllocator.h"
+#include "profiler.h"
+#include "eventJournal.h"
+#include "routeRegistry.h"
+
+#include <map>
+#include <memory>
 
 using namespace ns3;
 
@@ -25,6 +39,8 @@ class Constellation
 
         std::vector<TLE> TLEVector;
         std::vector<Orbit> OrbitVector;
+        // The decoded elements of every satellite in TLEVector, in the same order
+        std::vector<TLEElements> satelliteElements;
 
         // Constructor declaration
         Constellation(uint32_t satCount,
@@ -36,7 +52,8 @@ class Constellation
                       DataRate satInputDataRate,
                       double gsSatErrorRate,
                       double satSatErrorRate,
-                      TimeValue linkAcquisitionSec);
+                      TimeValue linkAcquisitionSec,
+                      std::string constellationCachePath = "");
 
 
         /**
@@ -46,8 +63,109 @@ class Constellation
          */
         void scheduleSimulation(int totalMinutes, int updateIntervalSeconds);
 
+        /**
+         * Set the amount of threads used for propagation and link evaluation in each update.
+         * Link changes are always committed by a single thread in a fixed order, so the result does not depend on the thread count.
+         * \param threadCount Total amount of threads, 1 runs everything on the simulation thread
+         */
+        void setThreadCount(uint32_t threadCount);
+
+        /**
+         * Predict when every link will leave its elevation, distance or angle bounds, and break it exactly then, instead of
+         * re-checking every link each update. New links are only looked for when a terminal frees up.
+         * Must be called before scheduleSimulation().
+         */
+        void setEventDrivenLinks(bool enabled);
+
+        /**
+         * Compute the propagation delay of every packet from the length of its link at the time it is sent, interpolated
+         * between the positions at the start and end of the update interval. When disabled, the delay is fixed when the
+         * link is established. Disabled by default, must be called before scheduleSimulation().
+         */
+        void setInterpolatedLinkDelay(bool enabled);
+
+        /**
+         * Record every link change of the following scheduleSimulation() into a contact plan instead of computing routes.
+         * Meant for a run without applications, whose plan is written with saveContactPlan() afterwards.
+         */
+        void recordContactPlan();
+
+        /**
+         * Choose how routes are computed after the topology changes.
+         *  - "global":      Ipv4GlobalRoutingHelper::RecomputeRoutingTables(), rebuilding every table from scratch
+         *  - "incremental": ConstellationRouting, repairing shortest path trees with only the links that changed
+         *  - "gs":          ConstellationRouting towards the ground station subnets only, with one tree per ground station
+         * Must be called before scheduleSimulation().
+         */
+        void setRoutingMode(std::string mode);
+
+        /**
+         * Choose what the routes minimize.
+         *  - "hops":    the amount of links, every link counting the same
+         *  - "latency": the propagation delay, with every link weighed by its current length and refreshed at every update
+         * With global routing the delay is set as the interface metric in microseconds, otherwise as the link weight.
+         */
+        void setRoutingMetric(std::string metric);
+
+        /**
+         * Choose which visible satellite a ground station links to when it needs a new one.
+         *  - "first":   the visible satellite with the lowest index
+         *  - "longest": the satellite with the longest remaining visibility window, estimated from the ephemeris
+         *  - "score":   the best trade-off between the remaining visibility window and the distance
+         */
+        void setHandoverPolicy(std::string policy);
+
+        /**
+         * Print how many times every ground station switched to another satellite.
+         */
+        void printHandoverCounts() const;
+
+        /**
+         * Choose the address block the inter-satellite link subnets are taken from, such as "2.0.0.0/8", and the prefix
+         * length of every link subnet. With 31, links are numbered as in RFC 3021, using only the two addresses of a /31.
+         * This only saves addresses: global routing exports one subnet per link whatever its prefix length, so the
+         * routing tables keep the same amount of routes.
+         * Must be called before scheduleSimulation().
+         */
+        void setLinkAddressBlock(std::string block, uint16_t linkPrefixLength);
+
+        /**
+         * Print how many inter-satellite link subnets were in use at most, out of the size of the block.
+         */
+        void printLinkAddressUsage() const;
+
+        /**
+         * Print how long recomputing the routes took per update, and how large the global routing tables grew.
+         */
+        void printRoutingStats() const;
+
+        /**
+         * Choose the ground station pairs whose routes are checked for breaks, as "src-dst" indexes separated by commas,
+         * such as "0-1,2-3". By default only the route from ground station 0 to ground station 1 is tracked.
+         * Must be called before scheduleSimulation().
+         */
+        void setTrackedFlows(std::string flows);
+
+        /**
+         * Print how often the route of every tracked flow broke or changed length.
+         */
+        void printFlowStats() const;
+
+        void saveContactPlan(std::string path);
+
+        /**
+         * Schedule the link changes of a contact plan made by recordContactPlan(), instead of scheduleSimulation().
+         * The geometry is not evaluated again, so the satellites are only shown at their starting positions in NetAnim.
+         */
+        void scheduleContactPlanReplay(std::string path);
+
 
     private:
+        // Benchmark/p5-benchmark.cc times the link validators and updates directly
+        friend class ConstellationBenchmark;
+        // Checks/p5-checks.cc compares the optimized kernels against their reference versions
+        friend class ConstellationChecks;
+
         uint32_t satelliteCount;
         uint32_t groundStationCount;
         
@@ -72,35 +190,61 @@ class Constellation
 
         // =============================================== Route break handling ===============================================
         /**
-         * Vector for keeping track of the current route as a vector of [satNode, netDev] pairs. 
-         * Check the route before link breaks occur. When breaking links afterwards, check if a the break affects the route.
-         * If so, save to a file at which time the break occured. This can then be used for plotting red lines where breaks occur, giving a stronger basis for conclusions
-         * based on graphs
-         * 
-         * This procedure requires the following changes:
-         *  - update destroyLink()
-         *  - add saveCompleteRoute()
-         *  - save link breaks to txt-file for plotting.
+         * Paths of the tracked flows, traced before links may break and cleared after the update. When destroying a link,
+         * the registry tells which flows used it. Breaks are written to out/flows_satCount<N>.csv and, for the first flow,
+         * to out/link_break_times_satCount<N>.log, which the plotters use to mark where the route broke.
+         */
+        Ptr<RouteRegistry> routeRegistry;
+
+        /**
+         * Trace the route of every tracked flow through the routing tables into the route registry
          */
-        std::vector<std::pair<Ptr<Node>, int>> currRoute;
+        void saveFlowRoutes();
 
         /**
-         * Save the current route to the 'currRoute' vector
+         * Trace the route from srcNode to dstNode hop by hop, as both ends of every link. Empty if there is no route.
          */
-        void saveCompleteRoute(Ptr<Node> srcNode, Ptr<Node> dstNode);
+        std::vector<RouteHop> traceRoute(Ptr<Node> srcNode, Ptr<Node> dstNode);
 
 
         // ==================== Initial setup ===================
         /**
          * Returns node container with all satellites
+         * The satellites and orbits come from the constellation cache if it was built from the same inputs, otherwise the
+         * text files are parsed and the cache is written for the next run.
          */
         NodeContainer createSatellitesFromTLEAndOrbits(std::string tleDataPath, std::string tleOrbitsPath);
 
+        /**
+         * Fill TLEVector, OrbitVector and satelliteElements from the text files.
+         * Satellites listed in the orbits but missing from the TLE data are reported and left out of OrbitVector.
+         */
+        void readTLEAndOrbits(std::string tleDataPath, std::string tleOrbitsPath);
+
+        /**
+         * Fill TLEVector, OrbitVector and satelliteElements from the constellation cache. Returns false on a cache miss.
+         */
+        bool loadConstellationCache(const std::string& cachePath, uint64_t cacheKey);
+
+        // Base path of the constellation caches, empty when caching is disabled. See ConstellationCache::pathForKey()
+        std::string constellationCachePath;
+
         /**
          * Returns node container with all groundstations
          */
         NodeContainer createGroundStations(std::vector<GeoCoordinate> groundStationsCoordinates);
 
+        /**
+         * Add a point-to-point netdevice to 'node', attached to its own SatLinkChannel for the rest of the simulation.
+         * Sets up the device like PointToPointHelper::Install() would, without creating a channel or a node for the other end.
+         */
+        Ptr<PointToPointNetDevice> createTerminal(Ptr<Node> node, DataRate dataRate, Ptr<ErrorModel> errorModel);
+
+        /**
+         * The channel owned by the netdevice with index netDevIndex on the node.
+         */
+        Ptr<SatLinkChannel> getTerminalChannel(Ptr<Node> node, int netDevIndex) const;
+
         /**
          * Initialize all the intra-plane links between the satellites.
          * Should be done in the beginning of the simulation, and only once!
@@ -120,6 +264,74 @@ class Constellation
 
         void updateGroundStationLinks();
 
+        /**
+         * Propagate every satellite to the current simulation time into 'state', unless it has already been done.
+         * Also computes the SRF bases of the satellites.
+         * Once the lookahead models exist, 'state' is interpolated between the snapshots of the ephemeris window instead.
+         */
+        void propagateConstellationState();
+
+        /**
+         * Set the positions of the satellites in NetAnim from 'state'.
+         */
+        void updateAnimationPositions();
+
+        /**
+         * Recompute the routing tables after the topology changed. When recording a contact plan, it is only recorded.
+         */
+        void recomputeRoutingTables();
+
+        // Cost of recomputeRoutingTables(), reported by printRoutingStats()
+        uint32_t routingRecomputeCount = 0;
+        double routingRecomputeSeconds = 0;
+        double maxRoutingRecomputeSeconds = 0;
+        uint64_t globalRouteCount = 0;         // routes in all global routing tables after the last recompute
+        uint64_t maxGlobalRouteCount = 0;
+
+        /**
+         * Count the routes in the global routing tables of all nodes.
+         */
+        uint64_t countGlobalRoutes() const;
+
+        // Shared topology of the ConstellationRouting protocols. Only set with the "incremental" and "gs" routing modes
+        Ptr<ConstellationRoutingGraph> routingGraph;
+
+        typedef enum RoutingMetric
+        {
+            METRIC_HOPS = 0,
+            METRIC_LATENCY
+        } RoutingMetric;
+
+        RoutingMetric routingMetric = METRIC_HOPS;
+
+        // Relative change of a link's delay before its weight is updated. Nearly every link moves by a few microseconds
+        // each update, and passing all of those on would make the routing graph rebuild its trees every time.
+        double metricChangeThreshold = 0.05;
+
+        /**
+         * Propagation delay in microseconds over 'distanceM', at least 1 such that no link is free.
+         */
+        uint32_t getLinkDelayUs(double distanceM) const;
+
+        /**
+         * Weigh every link by its current propagation delay, for the latency routing metric. Only links whose delay
+         * changed by more than 'metricChangeThreshold' since their weight was last set are updated. While recording a
+         * contact plan, those changes are recorded as LINK_UPDATE records instead, and a replay applies them from there.
+         */
+        void refreshLinkMetrics();
+
+        /**
+         * Store the delay of a link on both ends and weigh the link with it in the routing.
+         */
+        void setLinkDelay(uint32_t node1, int node1NetDeviceIndex, uint32_t node2, int node2NetDeviceIndex, uint32_t delayUs);
+
+        /**
+         * Set the delay of a link as the interface metric on both ends, which the global routing adds up instead of hops.
+         * Interface metrics are 16 bit, so delays above 65.535 ms are capped.
+         */
+        void setInterfaceMetrics(uint32_t node1, int node1NetDeviceIndex, uint32_t node2, int node2NetDeviceIndex, uint32_t delayUs);
+
+
     
         // ==================== Utility variables ===================
         typedef enum LinkType
@@ -128,34 +340,180 @@ class Constellation
             SAT_SAT
         } LinkType;
 
-        typedef struct AngleRange
+        // The angle ranges of the satellite NetDevices are defined by NetDeviceAngles in SRFMath.h
+
+        // The available inter satellite netdevices of every satellite, with bit n set if netdevice n (1-4) is free.
+        // A netdevice is taken as soon as a link is planned for it, which can be before the link is established.
+        static constexpr uint8_t allTerminalsFree = 0x1E;
+        std::vector<uint8_t> freeTerminalMasks;
+        // Satellites with at least one free netdevice, in no particular order, and the position of each satellite in that list
+        std::vector<uint32_t> satsWithFreeTerminals;
+        std::vector<uint32_t> freeTerminalListPositions;
+        // When each netdevice was last freed, indexed by [satellite index * terminalsPerNode + netdevice]. The netdevices
+        // of a satellite look for a new link in the order they were freed, which is the order the full scan tried them in.
+        std::vector<uint64_t> terminalReleaseOrder;
+        uint64_t terminalReleaseCount = 0;
+
+        bool isTerminalFree(uint32_t satIndex, int netDevIndex) const;
+        void takeTerminal(uint32_t satIndex, int netDevIndex);
+        void releaseTerminal(uint32_t satIndex, int netDevIndex);
+
+        // Snapshot of all satellite positions and velocities, propagated once per update.
+        ConstellationState state;
+        // Reference frames of all satellites, computed from 'state' once per update.
+        SRFBasisCache srfBases;
+
+        // Threads used for propagation and link evaluation
+        std::unique_ptr<ThreadPool> threadPool;
+
+        // An existing sat-sat link seen from the satellite 'satIndex', and whether it is still valid
+        typedef struct ExistingSatLink
+        {
+            uint32_t satIndex;
+            int netDevIndex;
+            uint32_t connSatIndex;
+            int connNetDevIndex;
+            bool valid;
+        } ExistingSatLink;
+
+        // A satellite that a satellite can establish a link to, and the netdevices the link would use
+        typedef struct LinkCandidate
         {
-            double minAngle;
-            double maxAngle;
-        } AngleRange;
+            uint32_t connSatIndex;
+            int netDevIndex;
+            int connNetDevIndex;
+            double distance;
+        } LinkCandidate;
+
+        // The link candidates of each satellite, scored in parallel every update
+        std::vector<std::vector<LinkCandidate>> linkCandidates;
 
-        const AngleRange NetDeviceAngles[4] = {
-            { -45.0,  45.0 }, // NetDev1 forward
-            {  45.0, 135.0 }, // NetDev2 left
-            { 135.0, 225.0 }, // NetDev3 back
-            { 225.0, 315.0 }  // NetDev4 right
-        };
+        // Grid of the satellite positions, rebuilt every update to find link candidates within range.
+        SatelliteGrid satelliteGrid;
 
-        // The available net devices of the satellites.
-        std::vector<std::vector<int>> availableSatNetDevices;
+        // Grid of the sub-satellite points, rebuilt every update to find the satellites a ground station might see.
+        VisibilityIndex visibilityIndex;
+        double visibilityCellDegrees = 5.0;
 
-        // Queue for providing ipv4 addresses for inter satellite links.
-        std::queue<std::pair<Ipv4Address, Ipv4Address>> linkAddressProvider;
-        int linkSubnetCounter = 0;
+        // Provides a subnet for every inter satellite link.
+        LinkAddressAllocator linkAddresses;
 
         bool firstTimeLinkEstablishing = true;
 
+        /**
+         * Collect every existing sat-sat link as seen from each of its two satellites.
+         */
+        std::vector<ExistingSatLink> collectExistingSatLinks();
+
+        /**
+         * Establish links on the free netdevices of the satellites. Returns the amount of links established.
+         */
+        int establishSatelliteLinks();
+
+
+
+        // ==================== Contact plans ===================
+        typedef enum ContactPlanMode
+        {
+            PLAN_NONE = 0,
+            PLAN_RECORD,
+            PLAN_REPLAY
+        } ContactPlanMode;
+
+        ContactPlanMode contactPlanMode = PLAN_NONE;
+        ContactPlan contactPlan;
+
+        /**
+         * Apply the contact plan records [begin, end), which all share the same time.
+         */
+        void applyContactRecords(size_t begin, size_t end);
+
+        /**
+         * Index of the first node of a link in the contact plan, which is the ground station index for GS-SAT links.
+         */
+        uint32_t getContactPlanIndex(Ptr<Node> node1, LinkType linkType);
+
+
+
+        // ==================== Event driven link breaks ===================
+        bool eventDrivenLinks = false;
+
+        // The TLE epoch that the mobility models start at
+        std::string tleEpoch;
+
+        // Mobility models running one update interval ahead of the simulation, by having their start date shifted
+        std::vector<Ptr<SatSGP4MobilityModel>> lookaheadMobilityModels;
+        Time lookaheadInterval;
+
+        // Snapshots at the start and end of the current prediction window. Link breaks are searched for in between, and
+        // the satellite link channels interpolate the length of their link from them.
+        Ptr<EphemerisWindow> ephemeris;
+
+        // Whether the channels compute the delay of every packet from the current length of their link
+        bool interpolatedLinkDelay = false;
+
+        // Amount of uniform samples per window, and the precision of the break time in seconds
+        uint32_t breakSearchSteps = 4;
+        double breakTimeResolution = 0.001;
+
+        // The scheduled break of every link with a predicted break, keyed by [nodeId, netDev] of both ends
+        std::map<std::pair<uint32_t, int>, EventId> scheduledLinkBreaks;
+
+        // Breaks at the same point in time share a single scan for new links
+        bool linkScanScheduled = false;
+
+        /**
+         * Create the lookahead mobility models, which are 'interval' ahead of the regular ones.
+         */
+        void createLookaheadMobilityModels(Time interval);
+
+        /**
+         * Find the break time of every link that does not have one scheduled yet, within the current prediction window.
+         */
+        void predictLinkBreaks();
+
+        /**
+         * Find the break time of a single link within the current prediction window, and schedule it if there is one.
+         * For a GS-sat link, GSnode should be node1 and SATnode should be node 2 in the parameters
+         */
+        void predictLinkBreak(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<Node> node2, int node2NetDeviceIndex, LinkType linkType);
+
+        /**
+         * Returns the first time in seconds in [start, end] where 'isValidAt' is false, or a negative number if it stays true.
+         * The window is sampled uniformly, after which the first failing sample is narrowed down by bisection.
+         */
+        double findBreakTime(const std::function<bool(double)>& isValidAt, double start, double end) const;
+
+        double findGSLinkBreakTime(uint32_t gsIndex, uint32_t satIndex, double start, double end) const;
+
+        double findSatLinkBreakTime(uint32_t satIndex, int netDeviceIndex, uint32_t connSatIndex, int connNetDeviceIndex,
+                                    double start, double end) const;
+
+        void scheduleLinkBreak(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<Node> node2, int node2NetDeviceIndex,
+                               LinkType linkType, double breakTime);
+
+        /**
+         * Cancel the scheduled break of the link on the node's netdevice, if it has one.
+         */
+        void cancelLinkBreak(Ptr<Node> node, int netDevIndex);
+
+        /**
+         * Break a link at its predicted time, and look for new links for the freed terminals.
+         */
+        void breakPredictedLink(Ptr<Node> node1, int node1NetDeviceIndex, Ptr<Node> node2, int node2NetDeviceIndex, LinkType linkType);
+
+        /**
+         * Schedule a scan for new links at the current time, unless one already is.
+         */
+        void scheduleLinkScan();
+
+        void scanForNewLinks();
+
 
 
         // ==================== Link establishing and destroying ===================
 
-        // Creates a channel between 2 nodes' specified netDevices with delay calculated based on
-        // distance and the datarate set from 'dataRate'.
+        // Connects the channels of 2 nodes' specified netDevices with delay calculated based on distance.
         // If establishing a GS-sat link, GSnode should be node1 and SATnode should be node 2 in the parameters
         // If link type is gs-sat, satellite is assigned an IP on the same subnet as the GS's already existing IP address.
         // If link type is sat-sat, they are both assigned an available IP address (linkAddressProvider)
@@ -168,7 +526,7 @@ class Constellation
                           LinkType linkType);
 
         // Destroy the link between node1 and node2's netdevices (specified by index).
-        // Makes sure to make all connected netdevices point to the NullChannel, avoiding dangling pointers
+        // Disconnects the channels of both netdevices, which stay attached to them for the next link
         // If destroying a GS-SAT link, GSnode should be node1 and SATnode should be node2 in the parameters
         // Sets down NetDevices and removes IP addresses
         void destroyLink(Ptr<Node> node1,
@@ -182,41 +540,111 @@ class Constellation
 
         // ==================== Utility NetDevice functions ===================
         /**
-         * Get the connected satellites node.
+         * Get the netdevice at the other end of the link on the nodes netdevice with index netDevIndex.
          */
         Ptr<NetDevice> getConnectedNetDev(Ptr<Node> GSNode, int netDevIndex);
 
         /**
-         * Check if there is a channel connected to the nodes netdevice with index netDevIndex, which has 2
-         * connected netdevices. This means a link exists. return true/false based on if the link exists
+         * Check if the nodes netdevice with index netDevIndex has a link. return true/false based on if the link exists
          */
         bool hasExistingLink(Ptr<Node> GSNode, int netDevIndex);
 
 
+
+        // ==================== Link state table ===================
+        static constexpr uint32_t NO_LINK = UINT32_MAX;
+        // Netdevice 0 is the loopback, 1-4 are the inter satellite terminals and 5 the ground station terminal
+        static constexpr int terminalsPerNode = 6;
+
+        // The link on a single terminal of a node, seen from that node
+        typedef struct LinkState
+        {
+            uint32_t peer;              // node ID at the other end, NO_LINK if the terminal is free
+            int peerTerminal;
+            uint32_t linkId;
+            Time established;
+            uint32_t delayUs;           // propagation delay the link is currently weighed with
+        } LinkState;
+
+        // Every terminal of every node, indexed by [node ID * terminalsPerNode + terminal]. Kept up to date by
+        // establishLink() and destroyLink(), so nothing has to be read back from the channels.
+        std::vector<LinkState> linkTable;
+        uint32_t nextLinkId = 0;
+
+        // Every link up/down, handover and route break, written to out/events_satCount<N>.csv
+        Ptr<EventJournal> journal;
+
+        LinkState& getLinkState(uint32_t nodeId, int terminal);
+        const LinkState& getLinkState(uint32_t nodeId, int terminal) const;
+
+        /**
+         * Forget the routes saved by saveFlowRoutes().
+         */
+        void clearFlowRoutes();
+
+
         
-        // ==================== Link pairs address handling =======================
+        // ==================== Ground station handover ===================
+        typedef enum HandoverPolicy
+        {
+            HANDOVER_FIRST,
+            HANDOVER_LONGEST,
+            HANDOVER_SCORE
+        } HandoverPolicy;
+
+        HandoverPolicy handoverPolicy = HANDOVER_FIRST;
+        // How far ahead visibility windows are estimated. Satellites visible for longer are counted as visible for this long.
+        double handoverHorizon = 900.0;             // seconds
+        // Score lost by a satellite at the maximum distance, relative to a window of the full horizon
+        double handoverDistanceWeight = 0.5;
+
+        // Links established by every ground station. Every link after the first is a handover.
+        std::vector<uint32_t> gsLinkCount;
+        // Node ID of the satellite each ground station was last linked to, NO_LINK before its first link
+        std::vector<uint32_t> gsPreviousSatellite;
+
         /**
-         * Get an address subnet pair for an inter satellite link.
+         * Seconds until the satellite is no longer valid for the ground station, capped at the handover horizon.
+         * The satellite is extrapolated along a circular orbit from its current position and velocity.
          */
-        std::pair<Ipv4Address, Ipv4Address> getLinkAddressPair();
+        double estimateVisibilityWindow(uint32_t gsIndex, uint32_t satIndex) const;
 
-        // Method for reclaiming a previously used address.
-        void releaseLinkAddressPair(Ipv4Address linkAddress_0, Ipv4Address linkAddress_1);
+        /**
+         * Pick the satellite for a ground station from 'candidates' (ascending satellite indexes) according to the
+         * handover policy. Satellites whose ground station terminal is in use are skipped. Returns satelliteCount if none
+         * of them is available.
+         */
+        uint32_t selectGSSatellite(uint32_t gsIndex, const std::vector<uint32_t>& candidates);
 
 
 
         // ==================== Link Validators =======================
+        // All validators read positions from the current 'state' snapshot.
         /**
          * Returns a bool telling us whether the link is allowed to exist or not.
          * This is based on GS elevation angle and distance between sat and GS
          */
-        bool gsIsLinkValid(Ptr<SatConstantPositionMobilityModel> GSMobModel, Ptr<SatSGP4MobilityModel>satMobModel);
+        bool gsIsLinkValid(uint32_t gsIndex, uint32_t satIndex);
+
+        /**
+         * Upper bound on the angle at the Earth's centre between a ground station and any satellite it can link to,
+         * given the highest satellite in the visibility index. Follows from both the elevation and the distance limit.
+         */
+        double gsCoverageAngle(uint32_t gsIndex) const;
 
-        bool satIsLinkValid(Ptr<SatSGP4MobilityModel> mobilityModel,
+        bool satIsLinkValid(uint32_t satIndex,
                             int netDeviceIndex,
-                            Ptr<SatSGP4MobilityModel> connMobilityModel,
+                            uint32_t connSatIndex,
                             int connNetDeviceIndex);
 
+        /**
+         * Same as above, but for positions and velocities at any point in time, e.g. interpolated ones.
+         */
+        bool gsIsLinkValid(Vector gsPos, Vector satPos) const;
+
+        bool satIsLinkValid(Vector satPos, Vector satVel, int netDeviceIndex,
+                            Vector connSatPos, Vector connSatVel, int connNetDeviceIndex) const;
+
 };
 
 #endif
@@ -0,0 +1,402 @@
+#include "constellationRouting.h"
+
+#include <functional>
+#include <limits>
+#include <queue>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Constellation-Routing");
+
+namespace
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    // Min-heap of [distance, node ID]. Ties are broken on the node ID, so the trees do not depend on insertion order
+    typedef std::priority_queue<std::pair<double, uint32_t>, std::vector<std::pair<double, uint32_t>>, std::greater<std::pair<double, uint32_t>>> NodeHeap;
+}
+
+ConstellationRoutingGraph::ConstellationRoutingGraph(uint32_t nodeCount) {
+    this->adjacency.resize(nodeCount);
+    this->affected.resize(nodeCount, 0);
+}
+
+void ConstellationRoutingGraph::addHost(Ipv4Address address, uint32_t nodeId) {
+    this->staticHostNodes[address.Get()] = nodeId;
+}
+
+void ConstellationRoutingGraph::addPrefix(Ipv4Address address, Ipv4Mask mask, uint32_t nodeId) {
+    this->prefixes.push_back({address.CombineMask(mask), mask, nodeId});
+    // Built on the current graph, and repaired along with every other tree from then on
+    if (this->trees.find(nodeId) == this->trees.end()) {
+        this->buildTree(nodeId, this->trees[nodeId]);
+    }
+}
+
+void ConstellationRoutingGraph::setRouteToLinkAddresses(bool enabled) {
+    this->routeToLinkAddresses = enabled;
+}
+
+void ConstellationRoutingGraph::addLink(uint32_t node1, uint32_t interface1, Ipv4Address address1, uint32_t node2, uint32_t interface2, Ipv4Address address2, double weight) {
+    this->pendingChanges.push_back({CHANGE_ADD, node1, interface1, address1, node2, interface2, address2, weight});
+}
+
+void ConstellationRoutingGraph::removeLink(uint32_t node1, uint32_t interface1, uint32_t node2, uint32_t interface2) {
+    this->pendingChanges.push_back({CHANGE_REMOVE, node1, interface1, Ipv4Address(), node2, interface2, Ipv4Address(), 0});
+}
+
+void ConstellationRoutingGraph::setLinkWeight(uint32_t node1, uint32_t interface1, uint32_t node2, uint32_t interface2, double weight) {
+    this->pendingChanges.push_back({CHANGE_WEIGHT, node1, interface1, Ipv4Address(), node2, interface2, Ipv4Address(), weight});
+}
+
+uint32_t ConstellationRoutingGraph::update() {
+    uint32_t changedNextHops = 0;
+
+    // Repairing a tree is only cheaper than building it again while few links change. Every node has at most 5 links,
+    // so more changes than nodes touch a large part of the graph.
+    bool rebuild = this->pendingChanges.size() > this->adjacency.size();
+
+    for (const LinkChange& change : this->pendingChanges) {
+        if (change.type == CHANGE_WEIGHT) {
+            Edge* edge1 = this->findEdgeOnInterface(change.node1, change.interface1);
+            Edge* edge2 = this->findEdgeOnInterface(change.node2, change.interface2);
+            NS_ASSERT_MSG(edge1 != nullptr && edge2 != nullptr, "No link between nodes " << change.node1 << " and " << change.node2 << " to weigh");
+            double oldWeight = edge1->weight;
+            edge1->weight = change.weight;
+            edge2->weight = change.weight;
+            if (rebuild || change.weight == oldWeight) {
+                continue;
+            }
+
+            for (auto& [destination, tree] : this->trees) {
+                if (change.weight < oldWeight) {
+                    changedNextHops += this->propagateDecrease(tree, change.node1, change.node2, change.weight);
+                    changedNextHops += this->propagateDecrease(tree, change.node2, change.node1, change.weight);
+                } else {
+                    // The link is still there, so the repair weighs it against the other links with its new weight
+                    if (tree.next[change.node1] == change.node2) {
+                        changedNextHops += this->repairSubtree(tree, change.node1);
+                    }
+                    if (tree.next[change.node2] == change.node1) {
+                        changedNextHops += this->repairSubtree(tree, change.node2);
+                    }
+                }
+            }
+        } else if (change.type == CHANGE_ADD) {
+            this->adjacency[change.node1].push_back({change.node2, change.interface1, change.address2, change.weight});
+            this->adjacency[change.node2].push_back({change.node1, change.interface2, change.address1, change.weight});
+            if (this->routeToLinkAddresses) {
+                this->hostNodes[change.address1.Get()] = change.node1;
+                this->hostNodes[change.address2.Get()] = change.node2;
+            }
+
+            for (auto& [destination, tree] : this->trees) {
+                if (rebuild) {
+                    break;
+                }
+                changedNextHops += this->propagateDecrease(tree, change.node1, change.node2, change.weight);
+                changedNextHops += this->propagateDecrease(tree, change.node2, change.node1, change.weight);
+            }
+        } else {
+            // Forget the link addresses, and the edges in both directions
+            for (auto [nodeId, interface] : {std::pair(change.node1, change.interface1), std::pair(change.node2, change.interface2)}) {
+                std::vector<Edge>& edges = this->adjacency[nodeId];
+                for (auto edge = edges.begin(); edge != edges.end(); ++edge) {
+                    if (edge->interface == interface) {
+                        auto host = this->hostNodes.find(edge->gateway.Get());
+                        if (host != this->hostNodes.end() && host->second == edge->neighbour) {
+                            this->hostNodes.erase(host);
+                        }
+                        edges.erase(edge);
+                        break;
+                    }
+                }
+            }
+
+            for (auto& [destination, tree] : this->trees) {
+                if (rebuild) {
+                    break;
+                }
+                if (tree.next[change.node1] == change.node2) {
+                    changedNextHops += this->repairSubtree(tree, change.node1);
+                }
+                if (tree.next[change.node2] == change.node1) {
+                    changedNextHops += this->repairSubtree(tree, change.node2);
+                }
+            }
+        }
+    }
+    this->pendingChanges.clear();
+
+    if (rebuild) {
+        changedNextHops = this->rebuildTrees();
+    }
+
+    return changedNextHops;
+}
+
+bool ConstellationRoutingGraph::lookup(uint32_t nodeId, Ipv4Address destination, Edge& nextHop) {
+    uint32_t destinationNode;
+    if (!this->findDestinationNode(destination, destinationNode)) {
+        return false;
+    }
+
+    auto tree = this->trees.find(destinationNode);
+    if (tree == this->trees.end()) {
+        tree = this->trees.emplace(destinationNode, Tree()).first;
+        this->buildTree(destinationNode, tree->second);
+    }
+
+    uint32_t next = tree->second.next[nodeId];
+    if (next == NO_NEXT_HOP) {
+        return false;
+    }
+    const Edge* edge = this->findEdge(nodeId, next);
+    if (edge == nullptr) {
+        return false;
+    }
+    nextHop = *edge;
+    return true;
+}
+
+void ConstellationRoutingGraph::print(std::ostream& os, uint32_t nodeId) const {
+    os << "Destination node\tNext hop node\tInterface\tGateway\tDistance" << std::endl;
+    for (const auto& [destination, tree] : this->trees) {
+        uint32_t next = tree.next[nodeId];
+        const Edge* edge = (next == NO_NEXT_HOP) ? nullptr : this->findEdge(nodeId, next);
+        if (edge != nullptr) {
+            os << destination << "\t" << next << "\t" << edge->interface << "\t" << edge->gateway << "\t" << tree.distance[nodeId] << std::endl;
+        }
+    }
+}
+
+bool ConstellationRoutingGraph::findDestinationNode(Ipv4Address destination, uint32_t& nodeId) const {
+    auto host = this->staticHostNodes.find(destination.Get());
+    if (host != this->staticHostNodes.end()) {
+        nodeId = host->second;
+        return true;
+    }
+    host = this->hostNodes.find(destination.Get());
+    if (host != this->hostNodes.end()) {
+        nodeId = host->second;
+        return true;
+    }
+    for (const Prefix& prefix : this->prefixes) {
+        if (prefix.mask.IsMatch(destination, prefix.network)) {
+            nodeId = prefix.nodeId;
+            return true;
+        }
+    }
+    return false;
+}
+
+const ConstellationRoutingGraph::Edge* ConstellationRoutingGraph::findEdge(uint32_t nodeId, uint32_t neighbour) const {
+    // Every node has at most 5 links, so a linear search is fine
+    for (const Edge& edge : this->adjacency[nodeId]) {
+        if (edge.neighbour == neighbour) {
+            return &edge;
+        }
+    }
+    return nullptr;
+}
+
+ConstellationRoutingGraph::Edge* ConstellationRoutingGraph::findEdgeOnInterface(uint32_t nodeId, uint32_t interface) {
+    for (Edge& edge : this->adjacency[nodeId]) {
+        if (edge.interface == interface) {
+            return &edge;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t ConstellationRoutingGraph::rebuildTrees() {
+    uint32_t changedNextHops = 0;
+    std::vector<uint32_t> oldNext;
+    for (auto& [destination, tree] : this->trees) {
+        oldNext.swap(tree.next);
+        this->buildTree(destination, tree);
+        for (size_t n = 0; n < oldNext.size(); n++) {
+            changedNextHops += (oldNext[n] != tree.next[n]);
+        }
+    }
+    return changedNextHops;
+}
+
+void ConstellationRoutingGraph::buildTree(uint32_t destination, Tree& tree) {
+    tree.distance.assign(this->adjacency.size(), infinity);
+    tree.next.assign(this->adjacency.size(), NO_NEXT_HOP);
+    tree.distance[destination] = 0;
+
+    // Plain Dijkstra from the destination. Links are symmetric, so the distance to a node is also its distance back
+    NodeHeap heap;
+    heap.push({0, destination});
+    while (!heap.empty()) {
+        auto [distance, nodeId] = heap.top();
+        heap.pop();
+        if (distance > tree.distance[nodeId]) {
+            continue;
+        }
+        for (const Edge& edge : this->adjacency[nodeId]) {
+            if (distance + edge.weight < tree.distance[edge.neighbour]) {
+                tree.distance[edge.neighbour] = distance + edge.weight;
+                tree.next[edge.neighbour] = nodeId;
+                heap.push({tree.distance[edge.neighbour], edge.neighbour});
+            }
+        }
+    }
+    NS_LOG_DEBUG("Built routing tree towards node " << destination);
+}
+
+uint32_t ConstellationRoutingGraph::propagateDecrease(Tree& tree, uint32_t nodeId, uint32_t neighbour, double weight) {
+    if (tree.distance[neighbour] + weight >= tree.distance[nodeId]) {
+        return 0;
+    }
+    uint32_t changedNextHops = 1;
+    tree.distance[nodeId] = tree.distance[neighbour] + weight;
+    tree.next[nodeId] = neighbour;
+
+    // Only the nodes whose distance actually decreases are visited
+    NodeHeap heap;
+    heap.push({tree.distance[nodeId], nodeId});
+    while (!heap.empty()) {
+        auto [distance, current] = heap.top();
+        heap.pop();
+        if (distance > tree.distance[current]) {
+            continue;
+        }
+        for (const Edge& edge : this->adjacency[current]) {
+            if (distance + edge.weight < tree.distance[edge.neighbour]) {
+                tree.distance[edge.neighbour] = distance + edge.weight;
+                changedNextHops += tree.next[edge.neighbour] != current;
+                tree.next[edge.neighbour] = current;
+                heap.push({tree.distance[edge.neighbour], edge.neighbour});
+            }
+        }
+    }
+    return changedNextHops;
+}
+
+uint32_t ConstellationRoutingGraph::repairSubtree(Tree& tree, uint32_t root) {
+    // Find every node that forwards through 'root'. They are the only ones whose distance can have increased
+    std::vector<uint32_t> subtree = {root};
+    this->affected[root] = 1;
+    for (size_t n = 0; n < subtree.size(); n++) {
+        for (const Edge& edge : this->adjacency[subtree[n]]) {
+            if (!this->affected[edge.neighbour] && tree.next[edge.neighbour] == subtree[n]) {
+                this->affected[edge.neighbour] = 1;
+                subtree.push_back(edge.neighbour);
+            }
+        }
+    }
+
+    std::vector<uint32_t> previousNext(subtree.size());
+    for (size_t n = 0; n < subtree.size(); n++) {
+        previousNext[n] = tree.next[subtree[n]];
+        tree.distance[subtree[n]] = infinity;
+        tree.next[subtree[n]] = NO_NEXT_HOP;
+    }
+
+    // Seed the subtree with the best path into the rest of the tree, which is still correct
+    NodeHeap heap;
+    for (uint32_t nodeId : subtree) {
+        for (const Edge& edge : this->adjacency[nodeId]) {
+            if (!this->affected[edge.neighbour] && tree.distance[edge.neighbour] + edge.weight < tree.distance[nodeId]) {
+                tree.distance[nodeId] = tree.distance[edge.neighbour] + edge.weight;
+                tree.next[nodeId] = edge.neighbour;
+            }
+        }
+        if (tree.next[nodeId] != NO_NEXT_HOP) {
+            heap.push({tree.distance[nodeId], nodeId});
+        }
+    }
+
+    // Dijkstra restricted to the subtree
+    while (!heap.empty()) {
+        auto [distance, current] = heap.top();
+        heap.pop();
+        if (distance > tree.distance[current]) {
+            continue;
+        }
+        for (const Edge& edge : this->adjacency[current]) {
+            if (this->affected[edge.neighbour] && distance + edge.weight < tree.distance[edge.neighbour]) {
+                tree.distance[edge.neighbour] = distance + edge.weight;
+                tree.next[edge.neighbour] = current;
+                heap.push({tree.distance[edge.neighbour], edge.neighbour});
+            }
+        }
+    }
+
+    uint32_t changedNextHops = 0;
+    for (size_t n = 0; n < subtree.size(); n++) {
+        changedNextHops += tree.next[subtree[n]] != previousNext[n];
+        this->affected[subtree[n]] = 0;
+    }
+    return changedNextHops;
+}
+
+
+
+NS_OBJECT_ENSURE_REGISTERED(ConstellationRouting);
+
+TypeId ConstellationRouting::GetTypeId() {
+    static TypeId tid = TypeId("ns3::ConstellationRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<ConstellationRouting>();
+    return tid;
+}
+
+void ConstellationRouting::SetGraph(Ptr<ConstellationRoutingGraph> graph) {
+    this->graph = graph;
+}
+
+void ConstellationRouting::SetIpv4(Ptr<Ipv4> ipv4) {
+    this->ipv4 = ipv4;
+}
+
+void ConstellationRouting::DoDispose() {
+    this->ipv4 = nullptr;
+    this->graph = nullptr;
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+Ptr<Ipv4Route> ConstellationRouting::lookupRoute(Ipv4Address destination) {
+    ConstellationRoutingGraph::Edge nextHop;
+    uint32_t nodeId = this->ipv4->GetObject<Node>()->GetId();
+    if (!this->graph->lookup(nodeId, destination, nextHop)) {
+        return nullptr;
+    }
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(destination);
+    route->SetSource(this->ipv4->GetAddress(nextHop.interface, 0).GetLocal());
+    route->SetGateway(nextHop.gateway);
+    route->SetOutputDevice(this->ipv4->GetNetDevice(nextHop.interface));
+    return route;
+}
+
+Ptr<Ipv4Route> ConstellationRouting::RouteOutput(Ptr<Packet> /* p */, const Ipv4Header& header, Ptr<NetDevice> oif, Socket::SocketErrno& sockerr) {
+    Ptr<Ipv4Route> route = this->lookupRoute(header.GetDestination());
+    // An output device asked for by the socket can only be honoured if it is the one on the path
+    if (route != nullptr && oif != nullptr && route->GetOutputDevice() != oif) {
+        route = nullptr;
+    }
+    sockerr = (route != nullptr) ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+    return route;
+}
+
+bool ConstellationRouting::RouteInput(Ptr<const Packet> p, const Ipv4Header& header, Ptr<const NetDevice> /* idev */,
+                                      const UnicastForwardCallback& ucb, const MulticastForwardCallback& /* mcb */,
+                                      const LocalDeliverCallback& /* lcb */, const ErrorCallback& /* ecb */) {
+    Ptr<Ipv4Route> route = this->lookupRoute(header.GetDestination());
+    if (route == nullptr) {
+        return false;
+    }
+    ucb(route, p, header);
+    return true;
+}
+
+void ConstellationRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const {
+    std::ostream* os = stream->GetStream();
+    *os << "Node: " << this->ipv4->GetObject<Node>()->GetId() << ", Time: " << Simulator::Now().As(unit) << ", ConstellationRouting" << std::endl;
+    this->graph->print(*os, this->ipv4->GetObject<Node>()->GetId());
+}
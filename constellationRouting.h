@@ -0,0 +1,190 @@
+#ifndef CONSTELLATION_ROUTING_H
+#define CONSTELLATION_ROUTING_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * The topology of the constellation as a graph of node IDs, fed directly by the link changes of Constellation, together
+ * with the shortest path trees towards every destination that has been routed to.
+ *
+ * Link changes are queued, and applied in update() at the same points where the global routing tables used to be recomputed.
+ * Instead of running Dijkstra from every node again, each tree is repaired incrementally (dynamic SPF): a new link only
+ * propagates the distances it decreases, and a broken link only recomputes the subtree that was hanging below it.
+ * Trees are built the first time a packet is routed towards their destination, so only destinations in use cost anything.
+ */
+class ConstellationRoutingGraph : public SimpleRefCount<ConstellationRoutingGraph>
+{
+    public:
+        // Marks a node without a next hop, either because it is the destination or because it can not reach it
+        static constexpr uint32_t NO_NEXT_HOP = UINT32_MAX;
+
+        // A link seen from one of its nodes
+        typedef struct Edge
+        {
+            uint32_t neighbour;
+            uint32_t interface;         // the local interface of the link
+            Ipv4Address gateway;        // the address of the neighbour on the link
+            double weight;
+        } Edge;
+
+        explicit ConstellationRoutingGraph(uint32_t nodeCount);
+
+        /**
+         * Make a host address, such as the static address of a ground station, resolve to 'nodeId'.
+         */
+        void addHost(Ipv4Address address, uint32_t nodeId);
+
+        /**
+         * Make every address in the prefix of 'address' resolve to 'nodeId', and build its tree right away.
+         */
+        void addPrefix(Ipv4Address address, Ipv4Mask mask, uint32_t nodeId);
+
+        /**
+         * Whether the addresses of the links themselves resolve to their nodes. When disabled, only the hosts and prefixes
+         * added explicitly can be routed to, so no trees or addresses are kept for the satellites.
+         */
+        void setRouteToLinkAddresses(bool enabled);
+
+        /**
+         * Queue a new link. 'address1' is the address of node1 on the link, and 'address2' the one of node2.
+         */
+        void addLink(uint32_t node1, uint32_t interface1, Ipv4Address address1,
+                     uint32_t node2, uint32_t interface2, Ipv4Address address2, double weight);
+
+        /**
+         * Queue the removal of an existing link.
+         */
+        void removeLink(uint32_t node1, uint32_t interface1, uint32_t node2, uint32_t interface2);
+
+        /**
+         * Queue a new weight for an existing link, such as its current propagation delay.
+         */
+        void setLinkWeight(uint32_t node1, uint32_t interface1, uint32_t node2, uint32_t interface2, double weight);
+
+        /**
+         * Apply the queued link changes to the graph and repair every tree. Returns the amount of next hops that changed.
+         * When most links change at once, as when every weight is refreshed, the trees are built again instead.
+         */
+        uint32_t update();
+
+        /**
+         * Find the next hop from 'nodeId' towards 'destination'. Returns false if the destination is unknown or unreachable.
+         */
+        bool lookup(uint32_t nodeId, Ipv4Address destination, Edge& nextHop);
+
+        /**
+         * Print the next hop of 'nodeId' towards every destination with a tree.
+         */
+        void print(std::ostream& os, uint32_t nodeId) const;
+
+    private:
+        typedef enum LinkChangeType
+        {
+            CHANGE_ADD = 0,
+            CHANGE_REMOVE,
+            CHANGE_WEIGHT
+        } LinkChangeType;
+
+        typedef struct LinkChange
+        {
+            LinkChangeType type;
+            uint32_t node1;
+            uint32_t interface1;
+            Ipv4Address address1;
+            uint32_t node2;
+            uint32_t interface2;
+            Ipv4Address address2;
+            double weight;
+        } LinkChange;
+
+        typedef struct Prefix
+        {
+            Ipv4Address network;
+            Ipv4Mask mask;
+            uint32_t nodeId;
+        } Prefix;
+
+        // Shortest path tree towards a single destination. 'next[n]' is the neighbour node n forwards to.
+        typedef struct Tree
+        {
+            std::vector<double> distance;
+            std::vector<uint32_t> next;
+        } Tree;
+
+        std::vector<std::vector<Edge>> adjacency;
+        std::unordered_map<uint32_t, uint32_t> hostNodes;      // link address -> node ID
+        std::unordered_map<uint32_t, uint32_t> staticHostNodes; // addresses from addHost(), which are never removed
+        std::vector<Prefix> prefixes;                           // only a handful, one per ground station
+        bool routeToLinkAddresses = true;
+        std::unordered_map<uint32_t, Tree> trees;              // destination node ID -> tree
+        std::vector<LinkChange> pendingChanges;
+
+        // Scratch space for marking the nodes that lost their path in a tree
+        std::vector<uint8_t> affected;
+
+        const Edge* findEdge(uint32_t nodeId, uint32_t neighbour) const;
+        Edge* findEdgeOnInterface(uint32_t nodeId, uint32_t interface);
+        bool findDestinationNode(Ipv4Address destination, uint32_t& nodeId) const;
+        void buildTree(uint32_t destination, Tree& tree);
+
+        /**
+         * Build every tree again on the current graph. Returns the amount of next hops that changed.
+         */
+        uint32_t rebuildTrees();
+
+        /**
+         * Let the new link from 'nodeId' to 'neighbour' shorten the paths of 'nodeId' and everything behind it.
+         */
+        uint32_t propagateDecrease(Tree& tree, uint32_t nodeId, uint32_t neighbour, double weight);
+
+        /**
+         * Recompute the paths of 'root' and every node forwarding through it, after the link to its next hop was removed.
+         */
+        uint32_t repairSubtree(Tree& tree, uint32_t root);
+};
+
+/**
+ * Routing protocol that forwards along the trees of a shared ConstellationRoutingGraph.
+ * One is installed on every node of the constellation, with a higher priority than the static and global routing.
+ * Local delivery is left to Ipv4ListRouting.
+ */
+class ConstellationRouting : public Ipv4RoutingProtocol
+{
+    public:
+        static TypeId GetTypeId();
+
+        void SetGraph(Ptr<ConstellationRoutingGraph> graph);
+
+        Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p, const Ipv4Header& header, Ptr<NetDevice> oif, Socket::SocketErrno& sockerr) override;
+        bool RouteInput(Ptr<const Packet> p, const Ipv4Header& header, Ptr<const NetDevice> idev,
+                        const UnicastForwardCallback& ucb, const MulticastForwardCallback& mcb,
+                        const LocalDeliverCallback& lcb, const ErrorCallback& ecb) override;
+
+        // The topology is given by the graph, so interface changes are not needed
+        void NotifyInterfaceUp(uint32_t /* interface */) override {}
+        void NotifyInterfaceDown(uint32_t /* interface */) override {}
+        void NotifyAddAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */) override {}
+        void NotifyRemoveAddress(uint32_t /* interface */, Ipv4InterfaceAddress /* address */) override {}
+
+        void SetIpv4(Ptr<Ipv4> ipv4) override;
+        void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override;
+
+    protected:
+        void DoDispose() override;
+
+    private:
+        Ptr<Ipv4> ipv4;
+        Ptr<ConstellationRoutingGraph> graph;
+
+        Ptr<Ipv4Route> lookupRoute(Ipv4Address destination);
+};
+
+#endif
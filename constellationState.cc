@@ -0,0 +1,170 @@
+#include "constellationState.h"
+
+using namespace ns3;
+
+void ConstellationState::propagate(const std::vector<Ptr<SatSGP4MobilityModel>>& satMobModels, uint32_t satCount, ThreadPool& threadPool, Time timeOffset) {
+    this->x.resize(satCount);
+    this->y.resize(satCount);
+    this->z.resize(satCount);
+    this->vx.resize(satCount);
+    this->vy.resize(satCount);
+    this->vz.resize(satCount);
+
+    // The models are only accessed through references, as copying a Ptr from several threads is not safe
+    threadPool.parallelFor(satCount, [this, &satMobModels](uint32_t begin, uint32_t end) {
+        for (uint32_t n = begin; n < end; n++) {
+            Vector pos = satMobModels[n]->GetPosition();
+            Vector vel = satMobModels[n]->GetVelocity();
+            this->x[n] = pos.x;
+            this->y[n] = pos.y;
+            this->z[n] = pos.z;
+            this->vx[n] = vel.x;
+            this->vy[n] = vel.y;
+            this->vz[n] = vel.z;
+        }
+    });
+
+    this->time = Simulator::Now() + timeOffset;
+    this->propagated = true;
+}
+
+void ConstellationState::interpolate(const ConstellationState& from, const ConstellationState& to, ThreadPool& threadPool) {
+    uint32_t satCount = from.x.size();
+    this->x.resize(satCount);
+    this->y.resize(satCount);
+    this->z.resize(satCount);
+    this->vx.resize(satCount);
+    this->vy.resize(satCount);
+    this->vz.resize(satCount);
+
+    double now = Simulator::Now().GetSeconds();
+    threadPool.parallelFor(satCount, [this, &from, &to, now](uint32_t begin, uint32_t end) {
+        Vector pos;
+        Vector vel;
+        for (uint32_t n = begin; n < end; n++) {
+            interpolateSatellite(from, to, n, now, pos, vel);
+            this->x[n] = pos.x;
+            this->y[n] = pos.y;
+            this->z[n] = pos.z;
+            this->vx[n] = vel.x;
+            this->vy[n] = vel.y;
+            this->vz[n] = vel.z;
+        }
+    });
+
+    this->time = Simulator::Now();
+    this->propagated = true;
+}
+
+void ConstellationState::interpolateSatellite(const ConstellationState& from, const ConstellationState& to, uint32_t satIndex,
+                                              double time, Vector& position, Vector& velocity) {
+    double h = to.time.GetSeconds() - from.time.GetSeconds();
+    double s = (time - from.time.GetSeconds()) / h;
+    double s2 = s * s;
+    double s3 = s2 * s;
+
+    // Hermite basis functions and their derivatives with respect to s. At s = 0 this gives back 'from' exactly
+    double h00 = 2 * s3 - 3 * s2 + 1;
+    double h10 = s3 - 2 * s2 + s;
+    double h01 = -2 * s3 + 3 * s2;
+    double h11 = s3 - s2;
+    double d00 = 6 * s2 - 6 * s;
+    double d10 = 3 * s2 - 4 * s + 1;
+    double d01 = -6 * s2 + 6 * s;
+    double d11 = 3 * s2 - 2 * s;
+
+    auto interpolateAxis = [&](const std::vector<double>& p, const std::vector<double>& v,
+                               const std::vector<double>& pTo, const std::vector<double>& vTo, double& pos, double& vel) {
+        pos = h00 * p[satIndex] + h10 * h * v[satIndex] + h01 * pTo[satIndex] + h11 * h * vTo[satIndex];
+        vel = (d00 * p[satIndex] + d10 * h * v[satIndex] + d01 * pTo[satIndex] + d11 * h * vTo[satIndex]) / h;
+    };
+    interpolateAxis(from.x, from.vx, to.x, to.vx, position.x, velocity.x);
+    interpolateAxis(from.y, from.vy, to.y, to.vy, position.y, velocity.y);
+    interpolateAxis(from.z, from.vz, to.z, to.vz, position.z, velocity.z);
+}
+
+Vector ConstellationState::extrapolateCircularOrbit(const Vector& position, const Vector& velocity, double dt) {
+    const double earthRotationRate = 7.2921159e-5;     // rad/s
+
+    // Inertial velocity, by adding back the rotation of the ECEF frame
+    Vector inertialVelocity(velocity.x - earthRotationRate * position.y, velocity.y + earthRotationRate * position.x, velocity.z);
+
+    // Orbit normal and mean motion from the angular momentum
+    Vector momentum(position.y * inertialVelocity.z - position.z * inertialVelocity.y,
+                    position.z * inertialVelocity.x - position.x * inertialVelocity.z,
+                    position.x * inertialVelocity.y - position.y * inertialVelocity.x);
+    double momentumLength = momentum.GetLength();
+    double radius2 = position.x * position.x + position.y * position.y + position.z * position.z;
+    double angle = (momentumLength / radius2) * dt;
+    Vector normal(momentum.x / momentumLength, momentum.y / momentumLength, momentum.z / momentumLength);
+
+    // Rotate the position around the orbit normal, which it is perpendicular to
+    Vector along(normal.y * position.z - normal.z * position.y,
+                 normal.z * position.x - normal.x * position.z,
+                 normal.x * position.y - normal.y * position.x);
+    Vector inertial(position.x * cos(angle) + along.x * sin(angle),
+                    position.y * cos(angle) + along.y * sin(angle),
+                    position.z * cos(angle) + along.z * sin(angle));
+
+    // Back to ECEF, where the Earth has rotated underneath the orbit
+    double earthAngle = earthRotationRate * dt;
+    return Vector(inertial.x * cos(earthAngle) + inertial.y * sin(earthAngle),
+                  -inertial.x * sin(earthAngle) + inertial.y * cos(earthAngle),
+                  inertial.z);
+}
+
+void ConstellationState::setGroundStations(const std::vector<Ptr<SatConstantPositionMobilityModel>>& gsMobModels) {
+    this->gsX.clear();
+    this->gsY.clear();
+    this->gsZ.clear();
+    for (const Ptr<SatConstantPositionMobilityModel>& gsMobModel : gsMobModels) {
+        Vector pos = gsMobModel->GetPosition();
+        this->gsX.emplace_back(pos.x);
+        this->gsY.emplace_back(pos.y);
+        this->gsZ.emplace_back(pos.z);
+    }
+}
+
+bool ConstellationState::isCurrent() const {
+    return this->propagated && this->time == Simulator::Now();
+}
+
+Vector ConstellationState::getPosition(uint32_t satIndex) const {
+    return Vector(this->x[satIndex], this->y[satIndex], this->z[satIndex]);
+}
+
+Vector ConstellationState::getVelocity(uint32_t satIndex) const {
+    return Vector(this->vx[satIndex], this->vy[satIndex], this->vz[satIndex]);
+}
+
+Vector ConstellationState::getGSPosition(uint32_t gsIndex) const {
+    return Vector(this->gsX[gsIndex], this->gsY[gsIndex], this->gsZ[gsIndex]);
+}
+
+double ConstellationState::getDistance(uint32_t satIndex0, uint32_t satIndex1) const {
+    return CalculateDistance(this->getPosition(satIndex0), this->getPosition(satIndex1));
+}
+
+double ConstellationState::getGSDistance(uint32_t gsIndex, uint32_t satIndex) const {
+    return CalculateDistance(this->getGSPosition(gsIndex), this->getPosition(satIndex));
+}
+
+bool EphemerisWindow::covers(double time) const {
+    // Both snapshots are taken by the time the window is used, unless the lookahead models were never created
+    return !this->to.x.empty() && time >= this->from.time.GetSeconds() && time <= this->to.time.GetSeconds();
+}
+
+Vector EphemerisWindow::getSatellitePosition(uint32_t satIndex, double time) const {
+    double h = this->to.time.GetSeconds() - this->from.time.GetSeconds();
+    double s = (time - this->from.time.GetSeconds()) / h;
+    double s2 = s * s;
+    double s3 = s2 * s;
+    double h00 = 2 * s3 - 3 * s2 + 1;
+    double h10 = (s3 - 2 * s2 + s) * h;
+    double h01 = -2 * s3 + 3 * s2;
+    double h11 = (s3 - s2) * h;
+
+    return Vector(h00 * this->from.x[satIndex] + h10 * this->from.vx[satIndex] + h01 * this->to.x[satIndex] + h11 * this->to.vx[satIndex],
+                  h00 * this->from.y[satIndex] + h10 * this->from.vy[satIndex] + h01 * this->to.y[satIndex] + h11 * this->to.vy[satIndex],
+                  h00 * this->from.z[satIndex] + h10 * this->from.vz[satIndex] + h01 * this->to.z[satIndex] + h11 * this->to.vz[satIndex]);
+}
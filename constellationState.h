@@ -0,0 +1,109 @@
+#ifndef CONSTELLATION_STATE_H
+#define CONSTELLATION_STATE_H
+
+#include "ns3/core-module.h"
+#include "ns3/satellite-module.h"
+
+#include "threadPool.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Snapshot of the ECEF positions and velocities of every satellite at a single point in time.
+ * SGP4 is run exactly once per satellite when the snapshot is taken, after which all link validators read
+ * from the contiguous arrays instead of asking the mobility models again.
+ * Ground stations never move, so their positions are only set once.
+ */
+class ConstellationState
+{
+    public:
+        // The simulation time the snapshot was taken at
+        Time time;
+
+        // Satellite positions (m) and velocities (m/s) in ECEF. Index n is satellite n.
+        std::vector<double> x, y, z;
+        std::vector<double> vx, vy, vz;
+
+        // Ground station positions (m) in ECEF. Index n is ground station n.
+        std::vector<double> gsX, gsY, gsZ;
+
+        /**
+         * Propagate the first 'satCount' mobility models to the current simulation time and store the results.
+         * The satellites are split across the threads of 'threadPool', as each one is propagated independently.
+         * 'timeOffset' is how far ahead of the simulation time the models are, e.g. when their start date has been shifted.
+         */
+        void propagate(const std::vector<Ptr<SatSGP4MobilityModel>>& satMobModels, uint32_t satCount, ThreadPool& threadPool,
+                       Time timeOffset = Seconds(0));
+
+        /**
+         * Fill the snapshot for the current simulation time by interpolating between the snapshots 'from' and 'to',
+         * instead of running SGP4 again. The current time must lie between the two snapshots.
+         */
+        void interpolate(const ConstellationState& from, const ConstellationState& to, ThreadPool& threadPool);
+
+        /**
+         * Cubic Hermite interpolation of a single satellite between the snapshots 'from' and 'to', using the positions
+         * and velocities at both ends. 'time' is the absolute simulation time in seconds.
+         */
+        static void interpolateSatellite(const ConstellationState& from, const ConstellationState& to, uint32_t satIndex,
+                                         double time, Vector& position, Vector& velocity);
+
+        /**
+         * Position of a satellite 'dt' seconds after it was at 'position' with 'velocity' (both ECEF), assuming a circular
+         * orbit. Good enough for estimating visibility windows minutes ahead, without running SGP4.
+         */
+        static Vector extrapolateCircularOrbit(const Vector& position, const Vector& velocity, double dt);
+
+        /**
+         * Store the positions of the ground stations.
+         */
+        void setGroundStations(const std::vector<Ptr<SatConstantPositionMobilityModel>>& gsMobModels);
+
+        /**
+         * Returns true if the snapshot has been taken at the current simulation time.
+         */
+        bool isCurrent() const;
+
+        Vector getPosition(uint32_t satIndex) const;
+        Vector getVelocity(uint32_t satIndex) const;
+        Vector getGSPosition(uint32_t gsIndex) const;
+
+        /**
+         * Distance in meters between two satellites. Equal to MobilityModel::GetDistanceFrom().
+         */
+        double getDistance(uint32_t satIndex0, uint32_t satIndex1) const;
+
+        /**
+         * Distance in meters between a ground station and a satellite. Equal to MobilityModel::GetDistanceFrom().
+         */
+        double getGSDistance(uint32_t gsIndex, uint32_t satIndex) const;
+
+    private:
+        bool propagated = false;
+};
+
+/**
+ * The snapshots at the start and end of the current update interval. Shared with the satellite link channels, such that
+ * they can compute the length of their link at any time in between without running SGP4.
+ */
+class EphemerisWindow : public SimpleRefCount<EphemerisWindow>
+{
+    public:
+        ConstellationState from;
+        ConstellationState to;
+
+        /**
+         * Returns true if 'time' (s) lies within the window, such that positions can be interpolated.
+         */
+        bool covers(double time) const;
+
+        /**
+         * ECEF position (m) of a satellite at 'time' (s), which must be covered by the window. Same cubic Hermite spline
+         * as ConstellationState::interpolateSatellite(), without the velocity.
+         */
+        Vector getSatellitePosition(uint32_t satIndex, double time) const;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "contactPlan.h"
+
+#include <cstring>
+#include <fstream>
+
+void ContactPlan::addRecord(ContactRecordType type, uint8_t linkType, uint32_t node1, int node1NetDevice,
+                            uint32_t node2, int node2NetDevice, double distance) {
+    ContactRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.timeNs = Simulator::Now().GetNanoSeconds();
+    record.distance = distance;
+    record.node1 = node1;
+    record.node2 = node2;
+    record.type = type;
+    record.linkType = linkType;
+    record.node1NetDevice = node1NetDevice;
+    record.node2NetDevice = node2NetDevice;
+    this->records.emplace_back(record);
+}
+
+void ContactPlan::write(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    NS_ABORT_MSG_IF(!file.is_open(), "Failed to open contact plan for writing: " << path);
+
+    uint64_t recordCount = this->records.size();
+    file.write("P5CP", 4);
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.write(reinterpret_cast<const char*>(&this->satCount), sizeof(this->satCount));
+    file.write(reinterpret_cast<const char*>(&this->gsCount), sizeof(this->gsCount));
+    file.write(reinterpret_cast<const char*>(&this->updateInterval), sizeof(this->updateInterval));
+    file.write(reinterpret_cast<const char*>(&this->simTime), sizeof(this->simTime));
+    file.write(reinterpret_cast<const char*>(&recordCount), sizeof(recordCount));
+    file.write(reinterpret_cast<const char*>(this->records.data()), recordCount * sizeof(ContactRecord));
+    NS_ABORT_MSG_IF(!file.good(), "Failed to write contact plan: " << path);
+}
+
+void ContactPlan::read(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    NS_ABORT_MSG_IF(!file.is_open(), "Failed to open contact plan: " << path);
+
+    char magic[4];
+    uint32_t fileVersion = 0;
+    uint64_t recordCount = 0;
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char*>(&fileVersion), sizeof(fileVersion));
+    NS_ABORT_MSG_IF(!file.good() || std::memcmp(magic, "P5CP", 4) != 0, path << " is not a contact plan");
+    // Version 2 only added a record type, so version 1 plans can still be replayed
+    NS_ABORT_MSG_IF(fileVersion == 0 || fileVersion > version, "Contact plan " << path << " has version " << fileVersion << ", expected at most " << version);
+    this->planVersion = fileVersion;
+
+    file.read(reinterpret_cast<char*>(&this->satCount), sizeof(this->satCount));
+    file.read(reinterpret_cast<char*>(&this->gsCount), sizeof(this->gsCount));
+    file.read(reinterpret_cast<char*>(&this->updateInterval), sizeof(this->updateInterval));
+    file.read(reinterpret_cast<char*>(&this->simTime), sizeof(this->simTime));
+    file.read(reinterpret_cast<char*>(&recordCount), sizeof(recordCount));
+
+    this->records.resize(recordCount);
+    file.read(reinterpret_cast<char*>(this->records.data()), recordCount * sizeof(ContactRecord));
+    NS_ABORT_MSG_IF(!file.good(), "Contact plan " << path << " is truncated");
+}
+
+bool ContactPlan::hasLinkUpdates() const {
+    return this->planVersion >= 2;
+}
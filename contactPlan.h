@@ -0,0 +1,82 @@
+#ifndef CONTACT_PLAN_H
+#define CONTACT_PLAN_H
+
+#include "ns3/core-module.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+typedef enum ContactRecordType
+{
+    LINK_UP = 0,
+    LINK_DOWN,
+    ROUTE_UPDATE,
+    LINK_UPDATE
+} ContactRecordType;
+
+/**
+ * A single change to the topology. For links, 'node1'/'node2' are indexes into the ground station or satellite nodes
+ * following the same order as establishLink(): for GS-SAT links node1 is the ground station and node2 the satellite.
+ * ROUTE_UPDATE marks a point where the routing tables were recomputed, and leaves the other fields zero. LINK_UPDATE gives
+ * the current length of an existing link whose delay changed by more than Constellation::metricChangeThreshold, with the
+ * same node order as its LINK_UP, such that the latency metric can be replayed without propagating the satellites.
+ */
+typedef struct ContactRecord
+{
+    int64_t timeNs;
+    double distance;        // meters, only used for LINK_UP and LINK_UPDATE
+    uint32_t node1;
+    uint32_t node2;
+    uint8_t type;           // ContactRecordType
+    uint8_t linkType;       // Constellation::LinkType
+    uint8_t node1NetDevice;
+    uint8_t node2NetDevice;
+    uint8_t reserved[4];
+} ContactRecord;
+
+static_assert(sizeof(ContactRecord) == 32, "ContactRecord is written to disk as is");
+
+/**
+ * Every link change of a simulation in the order it happened, such that a later run with the same constellation can
+ * apply them directly instead of evaluating the geometry again.
+ *
+ * On disk, the plan is a small header followed by the records as raw structs in native byte order:
+ *   "P5CP" | version | satCount | gsCount | updateInterval (s) | simTime (min) | recordCount | records...
+ */
+class ContactPlan
+{
+    public:
+        uint32_t satCount = 0;
+        uint32_t gsCount = 0;
+        double updateInterval = 0;
+        double simTime = 0;
+
+        std::vector<ContactRecord> records;
+
+        void addRecord(ContactRecordType type, uint8_t linkType, uint32_t node1, int node1NetDevice,
+                       uint32_t node2, int node2NetDevice, double distance);
+
+        /**
+         * Write the plan to 'path'. Aborts the simulation if the file can not be written.
+         */
+        void write(const std::string& path) const;
+
+        /**
+         * Read a plan written by write(). Aborts the simulation if the file is missing or not a contact plan.
+         */
+        void read(const std::string& path);
+
+        /**
+         * Whether the plan has LINK_UPDATE records. Version 1 plans only have the length of a link when it came up.
+         */
+        bool hasLinkUpdates() const;
+
+    private:
+        static constexpr uint32_t version = 2;
+        uint32_t planVersion = version;
+};
+
+#endif
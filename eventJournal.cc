@@ -0,0 +1,50 @@
+#include "eventJournal.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Event-Journal");
+
+static const char* eventNames[] = {"LINK_UP", "LINK_DOWN", "HANDOVER", "ROUTE_BREAK"};
+
+EventJournal::EventJournal(const std::string& path)
+    : file(path, std::ios::trunc) {
+    if (!this->file.is_open()) {
+        NS_LOG_ERROR("Failed to open file: " << path);
+    }
+    this->buffer.reserve(flushThreshold + 256);
+    this->buffer += "time_s,event,link,node1,terminal1,node2,terminal2,value\n";
+}
+
+EventJournal::~EventJournal() {
+    this->close();
+}
+
+void EventJournal::record(JournalEventType type, const char* link, uint32_t node1, int terminal1, uint32_t node2, int terminal2, double value) {
+    if (this->closed) {
+        return;
+    }
+    char line[160];
+    int length = std::snprintf(line, sizeof(line), "%.9g,%s,%s,%u,%d,%u,%d,%.9g\n",
+                               Simulator::Now().GetSeconds(), eventNames[type], link, node1, terminal1, node2, terminal2, value);
+    this->buffer.append(line, std::min<size_t>(length, sizeof(line) - 1));
+    if (this->buffer.size() >= flushThreshold) {
+        this->flush();
+    }
+}
+
+void EventJournal::flush() {
+    this->file.write(this->buffer.data(), this->buffer.size());
+    this->buffer.clear();
+}
+
+void EventJournal::close() {
+    if (this->closed) {
+        return;
+    }
+    this->closed = true;
+    this->flush();
+    this->file.close();
+}
@@ -0,0 +1,57 @@
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include "ns3/core-module.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+using namespace ns3;
+
+typedef enum JournalEventType
+{
+    EVENT_LINK_UP = 0,
+    EVENT_LINK_DOWN,
+    EVENT_HANDOVER,
+    EVENT_ROUTE_BREAK
+} JournalEventType;
+
+/**
+ * Every topology change of a simulation as one CSV stream, "time_s,event,link,node1,terminal1,node2,terminal2,value".
+ * Nodes are node IDs, and terminals the netdevice indexes, in the order establishLink() received them.
+ * 'value' is the distance in meters for LINK_UP, the node ID of the previous satellite for HANDOVER and the ID of the
+ * broken flow (see RouteRegistry) for ROUTE_BREAK.
+ *
+ * The file is opened once, and lines are collected in memory and written in large blocks.
+ */
+class EventJournal : public SimpleRefCount<EventJournal>
+{
+    public:
+        explicit EventJournal(const std::string& path);
+        ~EventJournal();
+
+        EventJournal(const EventJournal&) = delete;
+        EventJournal& operator=(const EventJournal&) = delete;
+
+        /**
+         * Record an event at the current simulated time.
+         */
+        void record(JournalEventType type, const char* link, uint32_t node1, int terminal1, uint32_t node2, int terminal2, double value = 0);
+
+        /**
+         * Write out everything recorded so far and close the files. Called by the destructor as well.
+         */
+        void close();
+
+    private:
+        static constexpr size_t flushThreshold = 1 << 20;    // bytes
+
+        std::ofstream file;
+        std::string buffer;
+        bool closed = false;
+
+        void flush();
+};
+
+#endif
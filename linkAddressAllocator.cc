@@ -0,0 +1,76 @@
+#include "linkAddressAllocator.h"
+
+#include <algorithm>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Link-Address-Allocator");
+
+void LinkAddressAllocator::configure(Ipv4Address blockAddress, Ipv4Mask blockMask, Ipv4Mask subnetMask) {
+    uint32_t blockPrefix = blockMask.GetPrefixLength();
+    uint32_t subnetPrefix = subnetMask.GetPrefixLength();
+    NS_ABORT_MSG_IF(subnetPrefix < blockPrefix, "Link subnets /" << subnetPrefix << " do not fit in a /" << blockPrefix << " block");
+    NS_ABORT_MSG_IF(subnetPrefix > 31, "Link subnets need room for two addresses");
+    NS_ABORT_MSG_IF(subnetPrefix - blockPrefix > 31, "Link address block has too many subnets");
+    NS_ABORT_MSG_IF(blockAddress.CombineMask(blockMask).Get() != blockAddress.Get(),
+                    "Link address block " << blockAddress << " is not aligned to its mask");
+
+    this->blockBase = blockAddress.Get();
+    this->subnetMask = subnetMask;
+    this->hostBits = 32 - subnetPrefix;
+    this->capacity = uint32_t(1) << (subnetPrefix - blockPrefix);
+
+    this->inUseBits.assign((this->capacity + 63) / 64, 0);
+    this->freeSubnets.clear();
+    this->nextUnusedSubnet = 0;
+    this->inUse = 0;
+    this->peakInUse = 0;
+}
+
+std::pair<Ipv4Address, Ipv4Address> LinkAddressAllocator::allocate() {
+    uint32_t subnet;
+    if (!this->freeSubnets.empty()) {
+        subnet = this->freeSubnets.front();
+        this->freeSubnets.pop_front();
+    } else if (this->nextUnusedSubnet < this->capacity) {
+        subnet = this->nextUnusedSubnet++;
+    } else {
+        NS_FATAL_ERROR("All " << this->capacity << " inter-satellite link subnets are in use, configure a larger link address block");
+    }
+    this->inUseBits[subnet / 64] |= uint64_t(1) << (subnet % 64);
+    this->inUse++;
+    this->peakInUse = std::max(this->peakInUse, this->inUse);
+
+    // Skip the network address, unless the subnet only has the two addresses of the link
+    uint32_t first = this->blockBase + (subnet << this->hostBits) + ((this->hostBits > 1) ? 1 : 0);
+    return std::make_pair(Ipv4Address(first), Ipv4Address(first + 1));
+}
+
+void LinkAddressAllocator::release(Ipv4Address address) {
+    uint32_t offset = address.Get() - this->blockBase;
+    uint32_t subnet = offset >> this->hostBits;
+    NS_ABORT_MSG_IF(address.Get() < this->blockBase || subnet >= this->capacity,
+                    "Link address " << address << " is not in the link address block");
+    uint64_t bit = uint64_t(1) << (subnet % 64);
+    NS_ABORT_MSG_IF((this->inUseBits[subnet / 64] & bit) == 0, "Link address " << address << " was released twice");
+
+    this->inUseBits[subnet / 64] &= ~bit;
+    this->inUse--;
+    this->freeSubnets.push_back(subnet);
+}
+
+Ipv4Mask LinkAddressAllocator::getSubnetMask() const {
+    return this->subnetMask;
+}
+
+uint32_t LinkAddressAllocator::getCapacity() const {
+    return this->capacity;
+}
+
+uint32_t LinkAddressAllocator::getInUse() const {
+    return this->inUse;
+}
+
+uint32_t LinkAddressAllocator::getPeakInUse() const {
+    return this->peakInUse;
+}
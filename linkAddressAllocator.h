@@ -0,0 +1,64 @@
+#ifndef LINK_ADDRESS_ALLOCATOR_H
+#define LINK_ADDRESS_ALLOCATOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Hands out one subnet of an address block to every inter-satellite link, and takes it back when the link breaks.
+ * The two ends of a link get the first two host addresses of its subnet.
+ *
+ * Subnets are numbered from the start of the block. A bitmap marks the subnets in use, subnets that have never been used
+ * are taken from the end of the used range, and released ones are kept in a FIFO free list, so both allocating and
+ * releasing are O(1). Running out of subnets is a fatal error, since links would otherwise share addresses.
+ */
+class LinkAddressAllocator
+{
+    public:
+        /**
+         * Split the block 'blockAddress'/'blockMask' into subnets of 'subnetMask'. Releases everything allocated so far.
+         */
+        void configure(Ipv4Address blockAddress, Ipv4Mask blockMask, Ipv4Mask subnetMask);
+
+        /**
+         * Allocate a subnet, returning the addresses of the two ends of the link.
+         */
+        std::pair<Ipv4Address, Ipv4Address> allocate();
+
+        /**
+         * Release the subnet of 'address', which may be either end of the link.
+         */
+        void release(Ipv4Address address);
+
+        Ipv4Mask getSubnetMask() const;
+
+        // Number of subnets in the block
+        uint32_t getCapacity() const;
+        // Number of subnets allocated right now
+        uint32_t getInUse() const;
+        // Highest number of subnets allocated at the same time
+        uint32_t getPeakInUse() const;
+
+    private:
+        uint32_t blockBase = 0;
+        Ipv4Mask subnetMask = Ipv4Mask("255.255.255.0");
+        uint32_t hostBits = 8;
+        uint32_t capacity = 0;
+
+        std::vector<uint64_t> inUseBits;
+        std::deque<uint32_t> freeSubnets;   // released subnets, reused in the order they were released
+        uint32_t nextUnusedSubnet = 0;      // every subnet from here on has never been allocated
+
+        uint32_t inUse = 0;
+        uint32_t peakInUse = 0;
+};
+
+#endif
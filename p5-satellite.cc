@@ -44,6 +44,19 @@ int main(int argc, char* argv[]) {
     std::string gsSatDataRate("100Mbps");
     std::string linkAcqTime("2s");
     std::string congestionCA = "TcpNewReno";
+    uint32_t threads = 1;
+    bool eventDriven = false;
+    bool interpolatedDelay = false;
+    std::string planMode = "none";
+    std::string routing = "global";
+    std::string routingMetric = "hops";
+    std::string handover = "first";
+    std::string linkAddressBlock = "2.0.0.0/8";
+    uint16_t linkPrefix = 24;
+    std::string traceFormat = "csv";
+    std::string trackedFlows = "0-1";
+    std::string contactPlanPath = "scratch/P5-Satellite/out/contact_plan.bin";
+    std::string constellationCachePath = "";
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("scenario", "[1=File upload, 2=Voice call]", scenario);
@@ -63,6 +76,19 @@ int main(int argc, char* argv[]) {
     cmd.AddValue("satSatDataRate", "DataRate from SAT-SAT", satSatDataRate);
     cmd.AddValue("gsSatDataRate", "DataRate from GS-SAT", gsSatDataRate);
     cmd.AddValue("linkAcqTime", "Link acquisition time", linkAcqTime);
+    cmd.AddValue("threads", "Amount of threads used for updating the constellation", threads);
+    cmd.AddValue("eventDriven", "Predict link breaks from the ephemeris instead of re-checking every link each update", eventDriven);
+    cmd.AddValue("interpolatedDelay", "Compute the delay of every packet from the current link length instead of the length when the link was made", interpolatedDelay);
+    cmd.AddValue("planMode", "Contact plan mode: none, precompute (only compute the links and save them) or replay (apply saved links)", planMode);
+    cmd.AddValue("contactPlan", "Contact plan path", contactPlanPath);
+    cmd.AddValue("constellationCache", "Constellation cache base path, such as scratch/P5-Satellite/out/constellation.cache. Each set of inputs gets its own cache file, used instead of parsing the TLE and orbit files (empty to disable)", constellationCachePath);
+    cmd.AddValue("handover", "Ground station handover policy: first (lowest index), longest (longest visibility window) or score (window and distance)", handover);
+    cmd.AddValue("linkAddressBlock", "Address block the inter-satellite link subnets are taken from", linkAddressBlock);
+    cmd.AddValue("linkPrefix", "Prefix length of every inter-satellite link subnet, 31 for RFC 3021 point-to-point addressing", linkPrefix);
+    cmd.AddValue("traceFormat", "Format of the CWND and RTT traces: csv, or binary (convert with UtilityPython/trace_to_csv.py)", traceFormat);
+    cmd.AddValue("routingMetric", "What routes minimize: hops, or latency (the propagation delay of every link)", routingMetric);
+    cmd.AddValue("trackedFlows", "Ground station pairs whose routes are checked for breaks, such as 0-1,2-3", trackedFlows);
+    cmd.AddValue("routing", "Routing: global (ns-3 global routing), incremental (constellation routing) or gs (constellation routing towards ground stations only)", routing);
     cmd.Parse(argc, argv);
     NS_LOG_INFO("[+] CommandLine arguments parsed succesfully");
 
@@ -115,10 +141,38 @@ int main(int argc, char* argv[]) {
                                    DataRate(satSatDataRate),
                                    bitErrorRate,
                                    bitErrorRate,
-                                   Time(linkAcqTime));
-
-    // Run simulationphase for x minutes with y second intervals. Includes an initial update at time 0.
-    LEOConstellation.scheduleSimulation(simTime, updateInterval);
+                                   Time(linkAcqTime),
+                                   constellationCachePath);
+    LEOConstellation.setThreadCount(threads);
+    LEOConstellation.setEventDrivenLinks(eventDriven);
+    LEOConstellation.setInterpolatedLinkDelay(interpolatedDelay);
+    LEOConstellation.setRoutingMode(routing);
+    LEOConstellation.setRoutingMetric(routingMetric);
+    LEOConstellation.setHandoverPolicy(handover);
+    LEOConstellation.setLinkAddressBlock(linkAddressBlock, linkPrefix);
+    LEOConstellation.setTrackedFlows(trackedFlows);
+
+    if (planMode == "precompute") {
+        // Only run the link assignment, without any applications or routing, and save every link change
+        LEOConstellation.recordContactPlan();
+        LEOConstellation.scheduleSimulation(simTime, updateInterval);
+        Simulator::Stop(Seconds(simTime * 60));
+        Simulator::Run();
+        LEOConstellation.saveContactPlan(contactPlanPath);
+        LEOConstellation.printHandoverCounts();
+        LEOConstellation.printLinkAddressUsage();
+        P5_PROFILE_WRITE("scratch/P5-Satellite/out/profile_trace.json", "scratch/P5-Satellite/out/profile_ticks.csv");
+        Simulator::Destroy();
+        return 0;
+    } else if (planMode == "replay") {
+        LEOConstellation.scheduleContactPlanReplay(contactPlanPath);
+    } else if (planMode == "none") {
+        // Run simulationphase for x minutes with y second intervals. Includes an initial update at time 0.
+        LEOConstellation.scheduleSimulation(simTime, updateInterval);
+    } else {
+        NS_LOG_UNCOND("Unknown contact plan mode " << planMode);
+        exit(1);
+    }
 
 
     // ============================== APPLICATIONS ==============================
@@ -173,8 +227,15 @@ int main(int argc, char* argv[]) {
 
     // ========================= TCP CWND TRACE TEST ========================
     // Each ground stations gets their traced set up!
-    Simulator::Schedule(MilliSeconds(1), &SetupTracing, gsNode0);
-    Simulator::Schedule(MilliSeconds(1), &SetupTracing, gsNode1);
+    Ptr<BinaryTraceWriter> traceWriter = nullptr;
+    if (traceFormat == "binary") {
+        traceWriter = Create<BinaryTraceWriter>("scratch/P5-Satellite/out/traces");
+    } else if (traceFormat != "csv") {
+        NS_LOG_UNCOND("Unknown trace format " << traceFormat);
+        exit(1);
+    }
+    Simulator::Schedule(MilliSeconds(1), &SetupTracing, gsNode0, traceWriter);
+    Simulator::Schedule(MilliSeconds(1), &SetupTracing, gsNode1, traceWriter);
     // ======================================================================
 
 
@@ -228,6 +289,14 @@ int main(int argc, char* argv[]) {
     NS_LOG_UNCOND("");
     NS_LOG_UNCOND("\x1b[31;1m[!]\x1b[37m Simulation is running!\x1b[0m");
     Simulator::Run();
+    if (traceWriter != nullptr) {
+        traceWriter->close();
+    }
+    LEOConstellation.printHandoverCounts();
+    LEOConstellation.printLinkAddressUsage();
+    LEOConstellation.printRoutingStats();
+    LEOConstellation.printFlowStats();
+    P5_PROFILE_WRITE("scratch/P5-Satellite/out/profile_trace.json", "scratch/P5-Satellite/out/profile_ticks.csv");
     Simulator::Destroy();
     return 0;
 }
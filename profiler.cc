@@ -0,0 +1,103 @@
+#include "profiler.h"
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Profiler");
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() : origin(Clock::now()) {
+}
+
+uint32_t Profiler::phaseIndex(const char* name) {
+    // Scopes pass string literals, so comparing the pointers first finds the phase without comparing strings
+    for (uint32_t n = 0; n < this->phaseLiterals.size(); n++) {
+        if (this->phaseLiterals[n] == name) {
+            return n;
+        }
+    }
+    for (uint32_t n = 0; n < this->phaseNames.size(); n++) {
+        if (this->phaseNames[n] == name) {
+            return n;
+        }
+    }
+    this->phaseNames.emplace_back(name);
+    this->phaseLiterals.push_back(name);
+    this->pendingPhaseSeconds.push_back(0);
+    return this->phaseNames.size() - 1;
+}
+
+uint64_t Profiler::sinceOrigin(Clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - this->origin).count();
+}
+
+void Profiler::recordScope(const char* name, Clock::time_point start, Clock::time_point end) {
+    uint32_t phase = this->phaseIndex(name);
+    uint64_t startUs = this->sinceOrigin(start);
+    this->events.push_back({phase, startUs, this->sinceOrigin(end) - startUs});
+    this->pendingPhaseSeconds[phase] += std::chrono::duration<double>(end - start).count();
+}
+
+void Profiler::recordTick(double simSeconds, Clock::time_point start, Clock::time_point end) {
+    if (!this->hasFirstTick) {
+        this->hasFirstTick = true;
+        this->firstTick = start;
+    }
+    this->recordScope("tick", start, end);
+
+    Tick tick;
+    tick.simSeconds = simSeconds;
+    tick.wallSeconds = std::chrono::duration<double>(end - this->firstTick).count();
+    tick.tickSeconds = std::chrono::duration<double>(end - start).count();
+    tick.phaseSeconds = this->pendingPhaseSeconds;
+    this->ticks.push_back(std::move(tick));
+    std::fill(this->pendingPhaseSeconds.begin(), this->pendingPhaseSeconds.end(), 0);
+}
+
+void Profiler::write(const std::string& tracePath, const std::string& csvPath) const {
+    std::ofstream trace(tracePath);
+    if (!trace.is_open()) {
+        NS_LOG_ERROR("Failed to open file: " << tracePath);
+        return;
+    }
+    // Complete events ("X") on a single thread; the phase names are identifiers, so they need no escaping
+    trace << "{\"traceEvents\":[";
+    for (size_t n = 0; n < this->events.size(); n++) {
+        const Event& event = this->events[n];
+        trace << (n == 0 ? "\n" : ",\n") << "{\"name\":\"" << this->phaseNames[event.phase] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+              << event.startUs << ",\"dur\":" << event.durationUs << "}";
+    }
+    trace << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    std::ofstream csv(csvPath);
+    if (!csv.is_open()) {
+        NS_LOG_ERROR("Failed to open file: " << csvPath);
+        return;
+    }
+    csv << "tick,sim_time_s,wall_time_s,tick_ms";
+    for (const std::string& name : this->phaseNames) {
+        if (name != "tick") {
+            csv << "," << name << "_ms";
+        }
+    }
+    csv << "\n";
+    for (size_t n = 0; n < this->ticks.size(); n++) {
+        const Tick& tick = this->ticks[n];
+        csv << n << "," << tick.simSeconds << "," << tick.wallSeconds << "," << 1e3 * tick.tickSeconds;
+        for (size_t phase = 0; phase < this->phaseNames.size(); phase++) {
+            if (this->phaseNames[phase] != "tick") {
+                csv << "," << ((phase < tick.phaseSeconds.size()) ? 1e3 * tick.phaseSeconds[phase] : 0.0);
+            }
+        }
+        csv << "\n";
+    }
+    NS_LOG_INFO("[+] Profile of " << this->ticks.size() << " ticks written to " << tracePath << " and " << csvPath);
+}
@@ -0,0 +1,122 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Wall time profiler for the phases of a constellation update. Phases are timed with P5_PROFILE_SCOPE(), and every
+ * update with P5_PROFILE_TICK(), which also closes a row of the per-tick table.
+ *
+ * write() exports two files:
+ *  - a Chrome trace-event JSON, with one complete event per timed scope, to open in chrome://tracing or Perfetto
+ *  - a CSV with one row per tick: the simulated time, the wall time since the first tick, the wall time of the tick
+ *    and the time spent in every phase since the previous tick. Link breaks between updates count towards the next tick.
+ *
+ * The macros compile to nothing unless P5_ENABLE_PROFILING is defined, so the profiler costs nothing by default.
+ * Only the simulation thread may record, the scopes are not meant for the tasks of the ThreadPool.
+ */
+class Profiler
+{
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        static Profiler& get();
+
+        /**
+         * Record a scope called 'name', which must be a string literal.
+         */
+        void recordScope(const char* name, Clock::time_point start, Clock::time_point end);
+
+        /**
+         * Record the end of a tick at simulated time 'simSeconds', which started at 'start'.
+         */
+        void recordTick(double simSeconds, Clock::time_point start, Clock::time_point end);
+
+        /**
+         * Write the trace to 'tracePath' and the per-tick table to 'csvPath'.
+         */
+        void write(const std::string& tracePath, const std::string& csvPath) const;
+
+    private:
+        typedef struct Event
+        {
+            uint32_t phase;         // index in phaseNames
+            uint64_t startUs;       // since 'origin'
+            uint64_t durationUs;
+        } Event;
+
+        typedef struct Tick
+        {
+            double simSeconds;
+            double wallSeconds;     // since the start of the first tick
+            double tickSeconds;
+            std::vector<double> phaseSeconds;   // indexed like phaseNames, may be shorter if phases were added later
+        } Tick;
+
+        Profiler();
+
+        uint32_t phaseIndex(const char* name);
+        uint64_t sinceOrigin(Clock::time_point time) const;
+
+        Clock::time_point origin;
+        bool hasFirstTick = false;
+        Clock::time_point firstTick;
+
+        std::vector<std::string> phaseNames;
+        std::vector<const char*> phaseLiterals;    // the literal every phase was first recorded with, for quick lookup
+        std::vector<Event> events;
+        std::vector<Tick> ticks;
+        std::vector<double> pendingPhaseSeconds;   // time per phase since the previous tick
+};
+
+/**
+ * Records the time between its construction and destruction as a scope of the Profiler.
+ */
+class ProfileScope
+{
+    public:
+        explicit ProfileScope(const char* name) : name(name), start(Profiler::Clock::now()) {}
+        ~ProfileScope() { Profiler::get().recordScope(this->name, this->start, Profiler::Clock::now()); }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        const char* name;
+        Profiler::Clock::time_point start;
+};
+
+/**
+ * Records the time between its construction and destruction as a tick, at the simulated time it was created at.
+ */
+class ProfileTick
+{
+    public:
+        explicit ProfileTick(double simSeconds) : simSeconds(simSeconds), start(Profiler::Clock::now()) {}
+        ~ProfileTick() { Profiler::get().recordTick(this->simSeconds, this->start, Profiler::Clock::now()); }
+
+        ProfileTick(const ProfileTick&) = delete;
+        ProfileTick& operator=(const ProfileTick&) = delete;
+
+    private:
+        double simSeconds;
+        Profiler::Clock::time_point start;
+};
+
+#define P5_PROFILE_CONCAT_INNER(a, b) a##b
+#define P5_PROFILE_CONCAT(a, b) P5_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef P5_ENABLE_PROFILING
+#define P5_PROFILE_SCOPE(name) ProfileScope P5_PROFILE_CONCAT(p5ProfileScope, __LINE__)(name)
+#define P5_PROFILE_TICK(simSeconds) ProfileTick P5_PROFILE_CONCAT(p5ProfileTick, __LINE__)(simSeconds)
+#define P5_PROFILE_WRITE(tracePath, csvPath) Profiler::get().write(tracePath, csvPath)
+#else
+#define P5_PROFILE_SCOPE(name) ((void)0)
+#define P5_PROFILE_TICK(simSeconds) ((void)0)
+#define P5_PROFILE_WRITE(tracePath, csvPath) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,130 @@
+#include "routeRegistry.h"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Route-Registry");
+
+uint32_t RouteRegistry::addFlow(uint32_t srcNode, uint32_t dstNode) {
+    Flow flow;
+    flow.srcNode = srcNode;
+    flow.dstNode = dstNode;
+    this->flows.push_back(flow);
+    return this->flows.size() - 1;
+}
+
+void RouteRegistry::clearFlows() {
+    this->flows.clear();
+    this->events.clear();
+    this->index.clear();
+}
+
+uint32_t RouteRegistry::getFlowCount() const {
+    return this->flows.size();
+}
+
+const RouteRegistry::Flow& RouteRegistry::getFlow(uint32_t flowId) const {
+    NS_ASSERT_MSG(flowId < this->flows.size(), "Unknown flow " << flowId);
+    return this->flows[flowId];
+}
+
+void RouteRegistry::setPath(uint32_t flowId, const std::vector<RouteHop>& hops) {
+    NS_ASSERT_MSG(flowId < this->flows.size(), "Unknown flow " << flowId);
+    this->dropPath(flowId);
+    Flow& flow = this->flows[flowId];
+    if (hops.empty()) {
+        return;
+    }
+
+    flow.path = hops;
+    for (const RouteHop& hop : flow.path) {
+        this->index[key(hop.first, hop.second)].push_back(flowId);
+    }
+
+    uint32_t hopCount = hops.size() / 2;
+    if (flow.lastHops != 0 && flow.lastHops != hopCount) {
+        flow.pathChanges++;
+        this->events.push_back({Simulator::Now().GetSeconds(), flowId, FLOW_PATH_CHANGE, hopCount, flow.lastHops, 0, 0});
+    }
+    flow.lastHops = hopCount;
+    flow.minHops = std::min(flow.minHops, hopCount);
+    flow.maxHops = std::max(flow.maxHops, hopCount);
+}
+
+void RouteRegistry::clearPaths() {
+    for (Flow& flow : this->flows) {
+        flow.path.clear();
+    }
+    this->index.clear();
+}
+
+const std::vector<uint32_t>& RouteRegistry::linkBroken(uint32_t nodeId, int terminal) {
+    this->brokenFlows.clear();
+    auto entry = this->index.find(key(nodeId, terminal));
+    if (entry == this->index.end()) {
+        return this->brokenFlows;
+    }
+    // Dropping the paths below edits the index, so the flows are copied out first
+    this->brokenFlows = entry->second;
+    double time = Simulator::Now().GetSeconds();
+    for (uint32_t flowId : this->brokenFlows) {
+        Flow& flow = this->flows[flowId];
+        flow.breaks++;
+        this->events.push_back({time, flowId, FLOW_BREAK, flow.lastHops, 0, nodeId, terminal});
+        this->dropPath(flowId);
+    }
+    return this->brokenFlows;
+}
+
+void RouteRegistry::dropPath(uint32_t flowId) {
+    Flow& flow = this->flows[flowId];
+    for (const RouteHop& hop : flow.path) {
+        auto entry = this->index.find(key(hop.first, hop.second));
+        if (entry == this->index.end()) {
+            continue;
+        }
+        std::vector<uint32_t>& users = entry->second;
+        users.erase(std::remove(users.begin(), users.end(), flowId), users.end());
+        if (users.empty()) {
+            this->index.erase(entry);
+        }
+    }
+    flow.path.clear();
+}
+
+void RouteRegistry::write(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        NS_LOG_ERROR("Failed to open file: " << path);
+        return;
+    }
+    file << "time_s,flow,src,dst,event,hops,previous_hops,node,terminal\n";
+    for (const FlowEvent& event : this->events) {
+        const Flow& flow = this->flows[event.flow];
+        file << event.time << "," << event.flow << "," << flow.srcNode << "," << flow.dstNode << ",";
+        if (event.type == FLOW_BREAK) {
+            file << "BREAK," << event.hops << ",," << event.node << "," << event.terminal << "\n";
+        } else {
+            file << "PATH_CHANGE," << event.hops << "," << event.previousHops << ",,\n";
+        }
+    }
+}
+
+void RouteRegistry::writeBreakTimes(uint32_t flowId, const std::string& path) const {
+    if (flowId >= this->flows.size() || this->flows[flowId].breaks == 0) {
+        return;
+    }
+    // Appended like the old per-break writes, so earlier runs with the same satellite count are kept
+    std::ofstream file(path, std::ios::app);
+    if (!file.is_open()) {
+        NS_LOG_ERROR("Failed to open file: " << path);
+        return;
+    }
+    for (const FlowEvent& event : this->events) {
+        if (event.flow == flowId && event.type == FLOW_BREAK) {
+            file << event.time << ",\n";
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef ROUTE_REGISTRY_H
+#define ROUTE_REGISTRY_H
+
+#include "ns3/core-module.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace ns3;
+
+// One end of a link on a route: node ID and netdevice index
+typedef std::pair<uint32_t, int> RouteHop;
+
+/**
+ * The current path of every tracked flow, with an index from each (node, terminal) on a path to the flows using it,
+ * such that the flows affected by a link break are found with one hash lookup instead of scanning every path.
+ *
+ * Paths are set by tracing the routing tables before links may break, and cleared again afterwards, as they are
+ * only valid until the routes are recomputed. A flow is broken at most once per traced path.
+ * Every break and every change in the hop count of a flow is kept, and written by write().
+ */
+class RouteRegistry : public SimpleRefCount<RouteRegistry>
+{
+    public:
+        typedef struct Flow
+        {
+            uint32_t srcNode;
+            uint32_t dstNode;
+            std::vector<RouteHop> path;     // both ends of every link from source to destination, empty if not traced
+            uint32_t lastHops = 0;          // links on the last traced path, 0 before the first one
+            uint32_t minHops = UINT32_MAX;
+            uint32_t maxHops = 0;
+            uint32_t breaks = 0;
+            uint32_t pathChanges = 0;
+        } Flow;
+
+        /**
+         * Track the flow from 'srcNode' to 'dstNode' (node IDs), returning its ID.
+         */
+        uint32_t addFlow(uint32_t srcNode, uint32_t dstNode);
+
+        /**
+         * Stop tracking every flow.
+         */
+        void clearFlows();
+
+        uint32_t getFlowCount() const;
+        const Flow& getFlow(uint32_t flowId) const;
+
+        /**
+         * Replace the path of the flow. 'hops' holds both ends of every link in order, so the hop count is half its size.
+         * An empty path means there is currently no route.
+         */
+        void setPath(uint32_t flowId, const std::vector<RouteHop>& hops);
+
+        /**
+         * Forget the paths of all flows, keeping their statistics.
+         */
+        void clearPaths();
+
+        /**
+         * The link on terminal 'terminal' of 'nodeId' is destroyed. Every flow whose path used it is counted as broken,
+         * and its path is dropped, such that further breaks before the next trace do not count again.
+         * Returns the IDs of the broken flows, valid until the next call.
+         */
+        const std::vector<uint32_t>& linkBroken(uint32_t nodeId, int terminal);
+
+        /**
+         * Write every flow event as "time_s,flow,src,dst,event,hops,previous_hops,node,terminal".
+         */
+        void write(const std::string& path) const;
+
+        /**
+         * Append the break times of one flow as "time," lines, the format the plotters read route breaks in.
+         */
+        void writeBreakTimes(uint32_t flowId, const std::string& path) const;
+
+    private:
+        typedef enum FlowEventType
+        {
+            FLOW_BREAK = 0,
+            FLOW_PATH_CHANGE
+        } FlowEventType;
+
+        typedef struct FlowEvent
+        {
+            double time;
+            uint32_t flow;
+            FlowEventType type;
+            uint32_t hops;
+            uint32_t previousHops;      // FLOW_PATH_CHANGE only
+            uint32_t node;              // FLOW_BREAK only, the end of the broken link
+            int terminal;
+        } FlowEvent;
+
+        std::vector<Flow> flows;
+        std::vector<FlowEvent> events;
+        // (node ID << 8 | terminal) -> flows whose current path uses that end of a link
+        std::unordered_map<uint64_t, std::vector<uint32_t>> index;
+        std::vector<uint32_t> brokenFlows;
+
+        static uint64_t key(uint32_t nodeId, int terminal) {
+            return (static_cast<uint64_t>(nodeId) << 8) | static_cast<uint8_t>(terminal);
+        }
+
+        void dropPath(uint32_t flowId);
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "satLinkChannel.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Sat-Link-Channel");
+
+NS_OBJECT_ENSURE_REGISTERED(SatLinkChannel);
+
+TypeId SatLinkChannel::GetTypeId() {
+    static TypeId tid = TypeId("ns3::SatLinkChannel")
+                            .SetParent<Channel>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<SatLinkChannel>()
+                            .AddTraceSource("TxRxPointToPoint",
+                                            "Trace source indicating transmission of packet from the PointToPointChannel, used by the Animation interface.",
+                                            MakeTraceSourceAccessor(&SatLinkChannel::txrxPointToPoint),
+                                            "ns3::PointToPointChannel::TxRxAnimationCallback");
+    return tid;
+}
+
+SatLinkChannel::SatLinkChannel() : delay(Seconds(0)) {
+}
+
+void SatLinkChannel::Connect(Ptr<PointToPointNetDevice> peer, Time delay) {
+    NS_ASSERT_MSG(this->peer == nullptr, "Channel is already connected");
+    this->peer = peer;
+    this->delay = delay;
+}
+
+void SatLinkChannel::TrackDistance(Ptr<EphemerisWindow> ephemeris, LinkEnd local, LinkEnd remote) {
+    NS_ASSERT_MSG(this->peer != nullptr, "Only a connected channel can track the distance of its link");
+    this->ephemeris = ephemeris;
+    this->ends[0] = local;
+    this->ends[1] = remote;
+}
+
+void SatLinkChannel::Disconnect() {
+    this->peer = nullptr;
+    this->ephemeris = nullptr;
+}
+
+bool SatLinkChannel::IsConnected() const {
+    return this->peer != nullptr;
+}
+
+bool SatLinkChannel::TransmitStart(Ptr<const Packet> p, Ptr<PointToPointNetDevice> src, Time txTime) {
+    if (this->peer == nullptr) {
+        NS_LOG_LOGIC("Dropping packet sent on a disconnected channel");
+        return false;
+    }
+    Time delay = this->GetDelay();
+    // Same as PointToPointChannel, except that only one direction is carried
+    Simulator::ScheduleWithContext(this->peer->GetNode()->GetId(), txTime + delay, &PointToPointNetDevice::Receive,
+                                   this->peer, p->Copy());
+    this->txrxPointToPoint(p, src, this->peer, txTime, txTime + delay);
+    return true;
+}
+
+Time SatLinkChannel::GetDelay() const {
+    if (this->ephemeris != nullptr) {
+        double now = Simulator::Now().GetSeconds();
+        if (this->ephemeris->covers(now)) {
+            return Seconds(CalculateDistance(this->getPosition(this->ends[0], now), this->getPosition(this->ends[1], now)) / speedOfLight);
+        }
+    }
+    return this->delay;
+}
+
+Vector SatLinkChannel::getPosition(const LinkEnd& end, double time) const {
+    if (end.satIndex == FIXED_END) {
+        return end.position;
+    }
+    return this->ephemeris->getSatellitePosition(end.satIndex, time);
+}
+
+std::size_t SatLinkChannel::GetNDevices() const {
+    return (this->peer == nullptr) ? 1 : 2;
+}
+
+Ptr<NetDevice> SatLinkChannel::GetDevice(std::size_t i) const {
+    // Device 0 is the one the channel was attached to, device 1 the peer
+    if (i == 1) {
+        return this->peer;
+    }
+    return PointToPointChannel::GetDevice(i);
+}
+
+void SatLinkChannel::DoDispose() {
+    this->peer = nullptr;
+    this->ephemeris = nullptr;
+    PointToPointChannel::DoDispose();
+}
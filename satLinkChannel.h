@@ -0,0 +1,83 @@
+#ifndef SAT_LINK_CHANNEL_H
+#define SAT_LINK_CHANNEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "constellationState.h"
+
+using namespace ns3;
+
+/**
+ * Point-to-point channel owned by a single terminal for the whole simulation. It is attached to its netdevice once, when
+ * the terminal is created, and a link is made by connecting it to the netdevice at the other end and setting the delay.
+ * Breaking the link only disconnects it again, so link churn does not create or dispose any channels.
+ *
+ * Both ends of a link have their own channel, each carrying the packets in its direction. Seen from the outside, a connected
+ * channel has the two devices of the link, same as a PointToPointChannel, and a disconnected one only has its own device.
+ * Packets sent while disconnected are dropped by the netdevice.
+ *
+ * The ends of a link keep moving while it lives. With TrackDistance(), the delay of every packet is computed from the
+ * length of the link at the moment it is sent, interpolated from the snapshots of the current update interval, instead
+ * of the delay given to Connect().
+ *
+ * The TypeId has Channel as its parent rather than PointToPointChannel. The TxRxPointToPoint trace NetAnim animates the
+ * packets with is private to PointToPointChannel, and ns-3 does not allow a child to register a trace source with the same
+ * name, so this channel registers and fires its own.
+ */
+class SatLinkChannel : public PointToPointChannel
+{
+    public:
+        static TypeId GetTypeId();
+
+        static constexpr uint32_t FIXED_END = UINT32_MAX;
+        static constexpr double speedOfLight = 299792458.0;     // m/s
+
+        // One end of a link: a satellite of the ephemeris, or a fixed position such as a ground station (ECEF, m)
+        typedef struct LinkEnd
+        {
+            uint32_t satIndex;          // FIXED_END for a fixed position
+            Vector position;
+        } LinkEnd;
+
+        SatLinkChannel();
+
+        /**
+         * Deliver the packets sent on this channel to 'peer', 'delay' after they have been transmitted.
+         */
+        void Connect(Ptr<PointToPointNetDevice> peer, Time delay);
+        /**
+         * Compute the delay of the packets from the distance between 'local' and 'remote' at the time they are sent,
+         * until the channel is disconnected. Outside of the window of 'ephemeris', the delay given to Connect() is used.
+         */
+        void TrackDistance(Ptr<EphemerisWindow> ephemeris, LinkEnd local, LinkEnd remote);
+
+        void Disconnect();
+        bool IsConnected() const;
+
+        /**
+         * Propagation delay of a packet sent now, the one given to Connect() unless the distance is tracked.
+         */
+        Time GetDelay() const;
+
+        bool TransmitStart(Ptr<const Packet> p, Ptr<PointToPointNetDevice> src, Time txTime) override;
+        std::size_t GetNDevices() const override;
+        Ptr<NetDevice> GetDevice(std::size_t i) const override;
+
+    protected:
+        void DoDispose() override;
+
+    private:
+        Ptr<PointToPointNetDevice> peer;
+        Time delay;
+
+        Ptr<EphemerisWindow> ephemeris;
+        LinkEnd ends[2];
+
+        TracedCallback<Ptr<const Packet>, Ptr<NetDevice>, Ptr<NetDevice>, Time, Time> txrxPointToPoint;
+
+        Vector getPosition(const LinkEnd& end, double time) const;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "spatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+uint64_t SatelliteGrid::cellKey(int32_t x, int32_t y, int32_t z) {
+    // Offset each coordinate so it is positive and pack them into 21 bits each
+    const int32_t offset = 1 << 20;
+    return  (static_cast<uint64_t>(x + offset) << 42) |
+            (static_cast<uint64_t>(y + offset) << 21) |
+             static_cast<uint64_t>(z + offset);
+}
+
+void SatelliteGrid::build(const std::vector<Vector>& positions, double cellSize) {
+    this->cellSize = cellSize;
+    this->positions = positions;
+
+    uint32_t count = positions.size();
+    this->cellX.resize(count);
+    this->cellY.resize(count);
+    this->cellZ.resize(count);
+
+    // Compute the cell of every satellite, and keep the key next to the index for sorting
+    std::vector<std::pair<uint64_t, uint32_t>> keyedSats(count);
+    for (uint32_t n = 0; n < count; n++) {
+        this->cellX[n] = static_cast<int32_t>(std::floor(positions[n].x / cellSize));
+        this->cellY[n] = static_cast<int32_t>(std::floor(positions[n].y / cellSize));
+        this->cellZ[n] = static_cast<int32_t>(std::floor(positions[n].z / cellSize));
+        keyedSats[n] = {cellKey(this->cellX[n], this->cellY[n], this->cellZ[n]), n};
+    }
+    // Sorting on (key, index) keeps the satellites in each cell in ascending index order
+    std::sort(keyedSats.begin(), keyedSats.end());
+
+    this->sortedSatIndexes.resize(count);
+    this->cellRanges.clear();
+    for (uint32_t n = 0; n < count; n++) {
+        this->sortedSatIndexes[n] = keyedSats[n].second;
+        if (n == 0 || keyedSats[n].first != keyedSats[n - 1].first) {
+            this->cellRanges[keyedSats[n].first] = {n, n + 1};
+        } else {
+            this->cellRanges[keyedSats[n].first].second = n + 1;
+        }
+    }
+}
+
+void SatelliteGrid::findNeighbours(uint32_t satIndex, double range, std::vector<uint32_t>& neighbours) const {
+    NS_ASSERT_MSG(range <= this->cellSize, "Neighbour range can not be larger than the grid cell size");
+    neighbours.clear();
+
+    const Vector& satPos = this->positions[satIndex];
+    // Look through the satellites own cell and the 26 cells surrounding it
+    for (int32_t dx = -1; dx <= 1; dx++) {
+        for (int32_t dy = -1; dy <= 1; dy++) {
+            for (int32_t dz = -1; dz <= 1; dz++) {
+                auto cell = this->cellRanges.find(cellKey(this->cellX[satIndex] + dx, this->cellY[satIndex] + dy, this->cellZ[satIndex] + dz));
+                if (cell == this->cellRanges.end()) {
+                    continue;
+                }
+                for (uint32_t i = cell->second.first; i < cell->second.second; i++) {
+                    uint32_t otherIndex = this->sortedSatIndexes[i];
+                    // Same distance calculation as MobilityModel::GetDistanceFrom(), so the range cut-off is exact
+                    if (otherIndex != satIndex && CalculateDistance(satPos, this->positions[otherIndex]) <= range) {
+                        neighbours.emplace_back(otherIndex);
+                    }
+                }
+            }
+        }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+}
+
+namespace
+{
+    // Bring a longitude that went past the antimeridian back into [-180, 180)
+    double wrapLongitude(double longitude) {
+        if (longitude < -180.0) {
+            return longitude + 360.0;
+        }
+        if (longitude >= 180.0) {
+            return longitude - 360.0;
+        }
+        return longitude;
+    }
+}
+
+uint32_t VisibilityIndex::latCell(double latitude) const {
+    int32_t cell = static_cast<int32_t>(std::floor((latitude + 90.0) / this->cellDegrees));
+    return std::clamp<int32_t>(cell, 0, this->latCells - 1);
+}
+
+uint32_t VisibilityIndex::lonCell(double longitude) const {
+    int32_t cell = static_cast<int32_t>(std::floor((longitude + 180.0) / this->cellDegrees));
+    return std::clamp<int32_t>(cell, 0, this->lonCells - 1);
+}
+
+void VisibilityIndex::build(const double* x, const double* y, const double* z, uint32_t count, double cellDegrees) {
+    this->cellDegrees = cellDegrees;
+    this->latCells = static_cast<uint32_t>(std::ceil(180.0 / cellDegrees));
+    this->lonCells = static_cast<uint32_t>(std::ceil(360.0 / cellDegrees));
+    this->maxRadius = 0;
+    this->directions.resize(count);
+
+    // Counting sort on the cell of every sub-satellite point. Satellites are visited in index order, so each cell
+    // keeps its satellites in ascending index order.
+    std::vector<uint32_t> satCells(count);
+    this->cellStart.assign(this->latCells * this->lonCells + 1, 0);
+    for (uint32_t n = 0; n < count; n++) {
+        double radius = std::sqrt(x[n] * x[n] + y[n] * y[n] + z[n] * z[n]);
+        this->maxRadius = std::max(this->maxRadius, radius);
+        this->directions[n] = Vector(x[n] / radius, y[n] / radius, z[n] / radius);
+
+        double latitude = std::asin(this->directions[n].z) * 180.0 / M_PI;
+        double longitude = std::atan2(y[n], x[n]) * 180.0 / M_PI;
+        satCells[n] = this->latCell(latitude) * this->lonCells + this->lonCell(longitude);
+        this->cellStart[satCells[n] + 1]++;
+    }
+    for (size_t cell = 1; cell < this->cellStart.size(); cell++) {
+        this->cellStart[cell] += this->cellStart[cell - 1];
+    }
+    this->sortedSatIndexes.resize(count);
+    std::vector<uint32_t> cellFill(this->cellStart.begin(), this->cellStart.end() - 1);
+    for (uint32_t n = 0; n < count; n++) {
+        this->sortedSatIndexes[cellFill[satCells[n]]++] = n;
+    }
+}
+
+void VisibilityIndex::findCandidates(const Vector& gsPos, double coverageAngle, std::vector<uint32_t>& candidates) const {
+    candidates.clear();
+
+    double gsRadius = gsPos.GetLength();
+    Vector gsDirection(gsPos.x / gsRadius, gsPos.y / gsRadius, gsPos.z / gsRadius);
+    double cosCoverage = std::cos(coverageAngle);
+
+    // Latitude band of the cap, in degrees
+    double gsLatitude = std::asin(gsDirection.z);
+    double gsLongitude = std::atan2(gsDirection.y, gsDirection.x);
+    double minLatitude = (gsLatitude - coverageAngle) * 180.0 / M_PI;
+    double maxLatitude = (gsLatitude + coverageAngle) * 180.0 / M_PI;
+
+    // Longitude half width of the cap, which covers every longitude once it reaches a pole
+    uint32_t firstLon = 0;
+    uint32_t lonCount = this->lonCells;
+    if (minLatitude > -90.0 && maxLatitude < 90.0) {
+        double halfWidth = std::asin(std::sin(coverageAngle) / std::cos(gsLatitude)) * 180.0 / M_PI;
+        double gsLongitudeDegrees = gsLongitude * 180.0 / M_PI;
+        firstLon = this->lonCell(wrapLongitude(gsLongitudeDegrees - halfWidth));
+        uint32_t lastLon = this->lonCell(wrapLongitude(gsLongitudeDegrees + halfWidth));
+        lonCount = (lastLon + this->lonCells - firstLon) % this->lonCells + 1;
+        if (2 * halfWidth + this->cellDegrees >= 360.0) {
+            firstLon = 0;
+            lonCount = this->lonCells;
+        }
+    }
+
+    for (uint32_t lat = this->latCell(minLatitude); lat <= this->latCell(maxLatitude); lat++) {
+        for (uint32_t i = 0; i < lonCount; i++) {
+            uint32_t cell = lat * this->lonCells + (firstLon + i) % this->lonCells;
+            for (uint32_t j = this->cellStart[cell]; j < this->cellStart[cell + 1]; j++) {
+                uint32_t satIndex = this->sortedSatIndexes[j];
+                const Vector& direction = this->directions[satIndex];
+                double cosAngle = direction.x * gsDirection.x + direction.y * gsDirection.y + direction.z * gsDirection.z;
+                if (cosAngle >= cosCoverage) {
+                    candidates.emplace_back(satIndex);
+                }
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+}
+
+double VisibilityIndex::getMaxRadius() const {
+    return this->maxRadius;
+}
@@ -0,0 +1,88 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include "ns3/core-module.h"
+
+#include <unordered_map>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Uniform 3D grid over the ECEF positions of the satellites, rebuilt once per update.
+ * With a cell size equal to the maximum link distance, every satellite within range of another
+ * lies in one of the 27 cells surrounding it, so candidate searches only visit those cells instead
+ * of the whole constellation.
+ */
+class SatelliteGrid
+{
+    public:
+        /**
+         * Bucket all positions into cells of size 'cellSize' (meters). Index n in 'positions' is satellite n.
+         */
+        void build(const std::vector<Vector>& positions, double cellSize);
+
+        /**
+         * Fill 'neighbours' with the indexes of all satellites within 'range' meters of satellite 'satIndex',
+         * excluding the satellite itself. Indexes are sorted in ascending order, such that iterating them
+         * gives the same order as a plain loop over all satellites. 'range' must not exceed the cell size.
+         */
+        void findNeighbours(uint32_t satIndex, double range, std::vector<uint32_t>& neighbours) const;
+
+    private:
+        double cellSize = 1.0;
+        std::vector<Vector> positions;
+
+        // Satellite indexes sorted by cell, and the [start, end) range in that vector for each occupied cell
+        std::vector<uint32_t> sortedSatIndexes;
+        std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> cellRanges;
+
+        // Cell coordinate of every satellite, so lookups do not need to recompute it
+        std::vector<int32_t> cellX, cellY, cellZ;
+
+        static uint64_t cellKey(int32_t x, int32_t y, int32_t z);
+};
+
+/**
+ * Latitude/longitude grid over the sub-satellite points of the satellites, rebuilt once per update.
+ * A ground station can only see satellites whose sub-satellite point lies within its coverage angle (the angle at the
+ * Earth's centre between the ground station and the satellite), so a visibility search only visits the cells that
+ * overlap that spherical cap instead of the whole constellation.
+ */
+class VisibilityIndex
+{
+    public:
+        /**
+         * Bucket the satellites at the ECEF positions 'x', 'y', 'z' into cells of 'cellDegrees' by 'cellDegrees'.
+         */
+        void build(const double* x, const double* y, const double* z, uint32_t count, double cellDegrees);
+
+        /**
+         * Fill 'candidates' with the indexes of all satellites within 'coverageAngle' (radians) of the direction of
+         * 'gsPos', seen from the Earth's centre. Indexes are sorted in ascending order, same as SatelliteGrid::findNeighbours().
+         */
+        void findCandidates(const Vector& gsPos, double coverageAngle, std::vector<uint32_t>& candidates) const;
+
+        /**
+         * Distance from the Earth's centre to the highest satellite, in meters.
+         */
+        double getMaxRadius() const;
+
+    private:
+        double cellDegrees = 1.0;
+        uint32_t latCells = 0;
+        uint32_t lonCells = 0;
+        double maxRadius = 0;
+
+        // Unit vector from the Earth's centre towards every satellite
+        std::vector<Vector> directions;
+
+        // Satellite indexes sorted by cell, and the start of every cell in that vector (cell count + 1 entries)
+        std::vector<uint32_t> sortedSatIndexes;
+        std::vector<uint32_t> cellStart;
+
+        uint32_t latCell(double latitude) const;
+        uint32_t lonCell(double longitude) const;
+};
+
+#endif
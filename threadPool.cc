@@ -0,0 +1,87 @@
+#include "threadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+    // The calling thread counts as one of the threads
+    for (uint32_t n = 1; n < threadCount; n++) {
+        this->workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->workAvailable.notify_all();
+    for (std::thread& worker : this->workers) {
+        worker.join();
+    }
+}
+
+uint32_t ThreadPool::getThreadCount() const {
+    return this->workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t begin, uint32_t end)>& task) {
+    if (count == 0) {
+        return;
+    }
+    // Without workers, there is nothing to coordinate
+    if (this->workers.empty()) {
+        task(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->task = &task;
+        this->count = count;
+        // Split into a few chunks per thread, such that uneven work still gets balanced
+        this->chunkSize = std::max<uint32_t>(1, count / (this->getThreadCount() * 8));
+        this->nextChunk = 0;
+        this->activeWorkers = this->workers.size();
+        this->generation++;
+    }
+    this->workAvailable.notify_all();
+
+    // Help out while waiting
+    this->runChunks();
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->workDone.wait(lock, [this]() { return this->activeWorkers == 0; });
+    this->task = nullptr;
+}
+
+void ThreadPool::runChunks() {
+    while (true) {
+        uint32_t begin = this->nextChunk.fetch_add(this->chunkSize);
+        if (begin >= this->count) {
+            return;
+        }
+        (*this->task)(begin, std::min(begin + this->chunkSize, this->count));
+    }
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->workAvailable.wait(lock, [this, seenGeneration]() { return this->stopping || this->generation != seenGeneration; });
+            if (this->stopping) {
+                return;
+            }
+            seenGeneration = this->generation;
+        }
+
+        this->runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->activeWorkers--;
+        }
+        this->workDone.notify_one();
+    }
+}
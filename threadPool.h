@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Small fork-join thread pool used for splitting the per-update work of the constellation across cores.
+ * The calling thread always takes part in the work, so a pool with a thread count of 1 has no worker threads
+ * and simply runs everything inline on the caller. This makes the serial and parallel paths run the exact same code.
+ *
+ * IMPORTANT: Tasks must not touch ns-3 objects through copies of Ptr<>, as their reference counting is not thread safe.
+ * They should only read shared data and write to their own indexes of the output.
+ */
+class ThreadPool
+{
+    public:
+        /**
+         * \param threadCount The total amount of threads to work with, including the calling thread
+         */
+        explicit ThreadPool(uint32_t threadCount);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        uint32_t getThreadCount() const;
+
+        /**
+         * Call 'task' on chunks [begin, end) covering the range [0, count), and block until every chunk is done.
+         */
+        void parallelFor(uint32_t count, const std::function<void(uint32_t begin, uint32_t end)>& task);
+
+    private:
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable workDone;
+
+        // The job currently being worked on. 'generation' is increased for every new job, so workers know when to wake up
+        const std::function<void(uint32_t, uint32_t)>* task = nullptr;
+        uint32_t count = 0;
+        uint32_t chunkSize = 1;
+        uint64_t generation = 0;
+        std::atomic<uint32_t> nextChunk{0};
+        uint32_t activeWorkers = 0;
+        bool stopping = false;
+
+        void workerLoop();
+        void runChunks();
+};
+
+#endif
@@ -1,7 +1,15 @@
 #include "tleHandler.h"
 
-#include <fstream>
-#include <sstream>
+#include <charconv>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-TLE-Handler");
 
 // Function to trim trailing spaces, carriage returns, and newline characters
 void TrimTrailingSpaces(std::string &str) {
@@ -11,55 +19,332 @@ void TrimTrailingSpaces(std::string &str) {
 
 // Function to read TLE file and format data into compatible string format
 std::vector<TLE> ReadTLEFile(const std::string &filename, std::string &TLEAge) {
-    std::ifstream file(filename);
+    TLECatalog catalog(filename);
     std::vector<TLE> tleData;
-    std::string line;
+    tleData.reserve(catalog.records.size());
 
-    // Get TLE data entry
-    std::getline(file, TLEAge);
-    TrimTrailingSpaces(TLEAge);
-    
-    while (std::getline(file, line)) {  // loop over all lines
-        TLE tleEntry;
-        tleEntry.name = line;         // First line is the satellite name, collect 3 lines at a time in the 'if'
-        if (std::getline(file, tleEntry.line1) && std::getline(file, tleEntry.line2)) {
-            // Trim extra whitespace and newlines
-            TrimTrailingSpaces(tleEntry.name);
-            TrimTrailingSpaces(tleEntry.line1);
-            TrimTrailingSpaces(tleEntry.line2);
-
-            tleData.push_back(tleEntry); // push to the back of the vecter containing the TLE
-                                         // entries from the file
-        }
+    TLEAge = std::string(catalog.epoch);
+    for (const TLERecord& record : catalog.records) {
+        tleData.push_back({std::string(record.name), std::string(record.line1), std::string(record.line2)});
     }
     return tleData;
 }
 
 // Function to read orbit file and format data into compatible string format
 std::vector<Orbit> ReadOrbitFile(const std::string &filename) {
-    std::ifstream file(filename);
+    OrbitCatalog catalog(filename);
     std::vector<Orbit> orbitData;
-    std::string line;
+    orbitData.reserve(catalog.records.size());
 
-    while (std::getline(file, line)) {
+    for (const OrbitRecord& record : catalog.records) {
         Orbit orbitEntry;
-        TrimTrailingSpaces(line); // Trim whitespace from the orbit name
-        orbitEntry.name = line;
-
-        if (std::getline(file, line)) {
-            TrimTrailingSpaces(line);  // Trim whitespace from the satellite names line
-
-            // Split the line by commas to get individual satellite names
-            std::stringstream ss(line);
-            std::string satelliteName;
-            while (std::getline(ss, satelliteName, ',')) {
-                TrimTrailingSpaces(satelliteName);  // Trim each satellite name
-                orbitEntry.satellites.push_back(satelliteName);  // Add satellite to the vector
+        orbitEntry.name = std::string(record.name);
+        for (std::string_view satelliteName : record.satellites) {
+            orbitEntry.satellites.emplace_back(satelliteName);
+        }
+        orbitData.push_back(std::move(orbitEntry));
+    }
+    return orbitData;
+}
+
+
+
+// ==================== Memory mapped files ===================
+MappedFile::MappedFile(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        NS_LOG_ERROR("Failed to open file: " << filename);
+        return;
+    }
+    this->open = true;
+
+    struct stat fileStat;
+    if (::fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        void* mapping = ::mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            this->data = static_cast<const char*>(mapping);
+            this->size = fileStat.st_size;
+        } else {
+            NS_LOG_ERROR("Failed to map file: " << filename);
+        }
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    this->unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : data(other.data), size(other.size), open(other.open) {
+    other.data = nullptr;
+    other.size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        this->unmap();
+        this->data = other.data;
+        this->size = other.size;
+        this->open = other.open;
+        other.data = nullptr;
+        other.size = 0;
+    }
+    return *this;
+}
+
+bool MappedFile::isOpen() const {
+    return this->open;
+}
+
+std::string_view MappedFile::view() const {
+    return std::string_view(this->data, this->size);
+}
+
+void MappedFile::unmap() {
+    if (this->data != nullptr) {
+        ::munmap(const_cast<char*>(this->data), this->size);
+        this->data = nullptr;
+        this->size = 0;
+    }
+}
+
+
+
+// ==================== Parsing helpers ===================
+namespace
+{
+    // A line with the trailing spaces, carriage returns and newlines trimmed, same as TrimTrailingSpaces()
+    struct Line
+    {
+        uint32_t number;
+        std::string_view text;
+    };
+
+    std::vector<Line> splitLines(std::string_view text) {
+        std::vector<Line> lines;
+        uint32_t lineNumber = 0;
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = text.find('\n', begin);
+            if (end == std::string_view::npos) {
+                end = text.size();
             }
+            std::string_view line = text.substr(begin, end - begin);
+            size_t last = line.find_last_not_of(" \r\n");
+            lines.push_back({++lineNumber, (last == std::string_view::npos) ? std::string_view() : line.substr(0, last + 1)});
+            begin = end + 1;
+        }
+        return lines;
+    }
+
+    std::string_view trimSpaces(std::string_view field) {
+        size_t first = field.find_first_not_of(' ');
+        if (first == std::string_view::npos) {
+            return std::string_view();
         }
+        return field.substr(first, field.find_last_not_of(' ') - first + 1);
+    }
 
-        orbitData.push_back(orbitEntry); // Add orbit entry to the list
+    // Parse the field at the 0-indexed column 'column' with 'length' characters
+    template <typename T>
+    bool parseField(std::string_view line, size_t column, size_t length, T& value) {
+        std::string_view field = trimSpaces(line.substr(column, length));
+        auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+        return !field.empty() && result.ec == std::errc() && result.ptr == field.data() + field.size();
     }
 
-    return orbitData;
+    // Floating point std::from_chars needs GCC 11, so doubles go through strtod on a null-terminated copy of the field
+    bool parseField(std::string_view line, size_t column, size_t length, double& value) {
+        std::string_view field = trimSpaces(line.substr(column, length));
+        char buffer[32];
+        if (field.empty() || field.size() >= sizeof(buffer)) {
+            return false;
+        }
+        field.copy(buffer, field.size());
+        buffer[field.size()] = '\0';
+        char* end;
+        value = std::strtod(buffer, &end);
+        return end == buffer + field.size();
+    }
+
+    bool isTLELine(std::string_view line, char lineNumber) {
+        return line.size() >= 2 && line[0] == lineNumber && line[1] == ' ';
+    }
+
+    // Returns an empty string if the line is a well formed TLE line, otherwise what is wrong with it
+    std::string checkTLELine(std::string_view line, char lineNumber) {
+        if (line.size() != 69) {
+            return "TLE line " + std::string(1, lineNumber) + " has " + std::to_string(line.size()) + " characters, expected 69";
+        }
+        // Modulo 10 sum of the digits of the first 68 characters, where minus signs count as 1
+        int checksum = 0;
+        for (size_t n = 0; n < 68; n++) {
+            if (line[n] >= '0' && line[n] <= '9') {
+                checksum += line[n] - '0';
+            } else if (line[n] == '-') {
+                checksum += 1;
+            }
+        }
+        if (line[68] - '0' != checksum % 10) {
+            return "TLE line " + std::string(1, lineNumber) + " has checksum " + line[68] + ", expected " + std::to_string(checksum % 10);
+        }
+        return "";
+    }
+
+    // Returns an empty string if all the elements could be parsed, otherwise the name of the first field that could not
+    std::string parseTLEElements(std::string_view line1, std::string_view line2, TLEElements& elements) {
+        uint32_t catalogNumber2 = 0;
+        uint32_t epochYear = 0;
+        uint32_t eccentricityDigits = 0;
+        if (!parseField(line1, 2, 5, elements.catalogNumber) || !parseField(line2, 2, 5, catalogNumber2)) {
+            return "catalog number";
+        }
+        if (elements.catalogNumber != catalogNumber2) {
+            return "catalog number (differs between the lines)";
+        }
+        if (!parseField(line1, 18, 2, epochYear) || !parseField(line1, 20, 12, elements.epochDay)) {
+            return "epoch";
+        }
+        // Two digit years from 57 and up are in the 1900s, the first satellite launched in 1957
+        elements.epochYear = (epochYear < 57) ? 2000 + epochYear : 1900 + epochYear;
+        if (!parseField(line2, 8, 8, elements.inclination)) {
+            return "inclination";
+        }
+        if (!parseField(line2, 17, 8, elements.raan)) {
+            return "RAAN";
+        }
+        // The eccentricity has an implied leading decimal point
+        if (!parseField(line2, 26, 7, eccentricityDigits)) {
+            return "eccentricity";
+        }
+        elements.eccentricity = eccentricityDigits / 1e7;
+        if (!parseField(line2, 34, 8, elements.argOfPerigee)) {
+            return "argument of perigee";
+        }
+        if (!parseField(line2, 43, 8, elements.meanAnomaly)) {
+            return "mean anomaly";
+        }
+        if (!parseField(line2, 52, 11, elements.meanMotion)) {
+            return "mean motion";
+        }
+        return "";
+    }
+}
+
+
+
+// ==================== Catalogs ===================
+TLECatalog::TLECatalog(const std::string& filename) : file(filename) {
+    std::vector<Line> lines = splitLines(this->file.view());
+    if (lines.empty()) {
+        return;
+    }
+
+    // Get TLE data entry
+    this->epoch = lines[0].text;
+
+    size_t i = 1;
+    while (i < lines.size()) {
+        const Line& nameLine = lines[i];
+        if (nameLine.text.empty()) {
+            i++;
+            continue;
+        }
+        if (isTLELine(nameLine.text, '1') || isTLELine(nameLine.text, '2')) {
+            this->errors.push_back({nameLine.number, "Expected a satellite name, found a TLE line"});
+            i++;
+            continue;
+        }
+        if (i + 2 >= lines.size()) {
+            this->errors.push_back({nameLine.number, "Incomplete entry for " + std::string(nameLine.text)});
+            break;
+        }
+        const Line& line1 = lines[i + 1];
+        const Line& line2 = lines[i + 2];
+        if (!isTLELine(line1.text, '1') || !isTLELine(line2.text, '2')) {
+            // Not an entry at all, so try again from the next line
+            this->errors.push_back({nameLine.number, "Entry for " + std::string(nameLine.text) + " is not followed by TLE lines 1 and 2"});
+            i++;
+            continue;
+        }
+        // From here the entry is complete, so a bad line only drops this entry
+        i += 3;
+
+        std::string problem = checkTLELine(line1.text, '1');
+        if (!problem.empty()) {
+            this->errors.push_back({line1.number, problem});
+            continue;
+        }
+        problem = checkTLELine(line2.text, '2');
+        if (!problem.empty()) {
+            this->errors.push_back({line2.number, problem});
+            continue;
+        }
+        TLERecord record = {nameLine.text, line1.text, line2.text, {}};
+        problem = parseTLEElements(line1.text, line2.text, record.elements);
+        if (!problem.empty()) {
+            this->errors.push_back({line1.number, "Could not parse the " + problem + " of " + std::string(nameLine.text)});
+            continue;
+        }
+        this->records.push_back(record);
+    }
+
+    this->index.reserve(this->records.size());
+    for (size_t n = 0; n < this->records.size(); n++) {
+        if (!this->index.emplace(this->records[n].name, n).second) {
+            NS_LOG_WARN(filename << ": " << this->records[n].name << " appears more than once, only the first entry is used");
+        }
+    }
+
+    for (const ParseError& error : this->errors) {
+        NS_LOG_WARN(filename << ":" << error.lineNumber << ": " << error.message);
+    }
+}
+
+const TLERecord* TLECatalog::find(std::string_view name) const {
+    auto it = this->index.find(name);
+    return (it == this->index.end()) ? nullptr : &this->records[it->second];
+}
+
+OrbitCatalog::OrbitCatalog(const std::string& filename) : file(filename) {
+    std::vector<Line> lines = splitLines(this->file.view());
+
+    size_t i = 0;
+    while (i < lines.size()) {
+        const Line& nameLine = lines[i];
+        if (nameLine.text.empty()) {
+            i++;
+            continue;
+        }
+        if (i + 1 >= lines.size() || lines[i + 1].text.empty()) {
+            this->errors.push_back({nameLine.number, "Orbit " + std::string(nameLine.text) + " has no satellites line"});
+            i++;
+            continue;
+        }
+
+        // Split the line by commas to get individual satellite names
+        OrbitRecord record;
+        record.name = nameLine.text;
+        std::string_view satellites = lines[i + 1].text;
+        size_t begin = 0;
+        while (begin <= satellites.size()) {
+            size_t end = satellites.find(',', begin);
+            if (end == std::string_view::npos) {
+                end = satellites.size();
+            }
+            std::string_view satelliteName = satellites.substr(begin, end - begin);
+            size_t last = satelliteName.find_last_not_of(" \r\n");
+            if (last != std::string_view::npos) {
+                record.satellites.push_back(satelliteName.substr(0, last + 1));
+            }
+            begin = end + 1;
+        }
+        this->records.push_back(std::move(record));
+        i += 2;
+    }
+
+    for (const ParseError& error : this->errors) {
+        NS_LOG_WARN(filename << ":" << error.lineNumber << ": " << error.message);
+    }
 }
@@ -3,6 +3,12 @@
 
 #include "ns3/satellite-module.h"
 
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
 void TrimTrailingSpaces(std::string& str);
 
 struct TLE
@@ -22,4 +28,112 @@ struct Orbit
 
 std::vector<Orbit> ReadOrbitFile(const std::string& filename);
 
+
+/**
+ * Read-only memory mapping of a whole file. Records parsed from it can point straight into the mapping.
+ * An empty or missing file gives an empty view; 'isOpen()' tells them apart.
+ */
+class MappedFile
+{
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        bool isOpen() const;
+        std::string_view view() const;
+
+    private:
+        const char* data = nullptr;
+        size_t size = 0;
+        bool open = false;
+
+        void unmap();
+};
+
+// A line of an input file that could not be parsed. Line numbers start at 1.
+struct ParseError
+{
+    uint32_t lineNumber;
+    std::string message;
+};
+
+/**
+ * Orbital elements decoded once from the two TLE lines.
+ */
+#pragma pack(push, 1)
+struct TLEElements
+{
+    uint32_t catalogNumber;
+    uint16_t epochYear;         // four digit year
+    double epochDay;            // day of the year including the fraction, 1.0 is January 1st 00:00 UTC
+    double inclination;         // degrees
+    double raan;                // right ascension of the ascending node, degrees
+    double eccentricity;
+    double argOfPerigee;        // degrees
+    double meanAnomaly;         // degrees
+    double meanMotion;          // revolutions per day
+};
+#pragma pack(pop)
+
+struct TLERecord
+{
+    std::string_view name;
+    std::string_view line1;
+    std::string_view line2;
+    TLEElements elements;
+};
+
+/**
+ * TLE catalog parsed directly from a memory mapped file. The first line of the file is the epoch the data was taken at,
+ * followed by [name, line 1, line 2] for every satellite. All strings point into the mapping, so the catalog must outlive them.
+ * Entries with missing lines, wrong line numbers, short lines or bad checksums are left out and listed in 'errors'.
+ * The records are indexed by name; if a name appears more than once, the first record is the one found.
+ */
+class TLECatalog
+{
+    public:
+        std::string_view epoch;
+        std::vector<TLERecord> records;
+        std::vector<ParseError> errors;
+
+        explicit TLECatalog(const std::string& filename);
+
+        /**
+         * Find the record of the satellite called 'name'. Returns nullptr if the catalog does not contain it.
+         */
+        const TLERecord* find(std::string_view name) const;
+
+    private:
+        MappedFile file;
+        std::unordered_map<std::string_view, size_t> index;     // name -> index in records
+};
+
+struct OrbitRecord
+{
+    std::string_view name;
+    std::vector<std::string_view> satellites;
+};
+
+/**
+ * Orbit file parsed directly from a memory mapped file. Every orbit is a name line followed by a line with the
+ * comma separated names of its satellites. Orbits without that line are left out and listed in 'errors'.
+ */
+class OrbitCatalog
+{
+    public:
+        std::vector<OrbitRecord> records;
+        std::vector<ParseError> errors;
+
+        explicit OrbitCatalog(const std::string& filename);
+
+    private:
+        MappedFile file;
+};
+
 #endif
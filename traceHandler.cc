@@ -4,6 +4,8 @@
 #include "ns3/network-module.h"
 #include "ns3/socket.h"
 
+#include "traceHandler.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("P5TraceHandler");
@@ -12,15 +14,24 @@ NS_LOG_COMPONENT_DEFINE("P5TraceHandler");
 #define NS_LOG_APPEND_CONTEXT std::clog << "[TraceHandler] ";
 
 
+// The streams are flushed when they are closed at the end of the simulation, not on every event
 void CwndTraceSink(Ptr<OutputStreamWrapper> logStream, uint32_t oldval, uint32_t newval) {
-    *logStream->GetStream() << Simulator::Now().GetSeconds() << "," << newval << std::endl;
+    *logStream->GetStream() << Simulator::Now().GetSeconds() << "," << newval << "\n";
 }
 
 void RTTTrace(Ptr<OutputStreamWrapper> logStream, Time oldRtt, Time newRtt) {
-    *logStream->GetStream() << Simulator::Now().GetSeconds() << "," << newRtt.GetDouble() << std::endl;
+    *logStream->GetStream() << Simulator::Now().GetSeconds() << "," << newRtt.GetDouble() << "\n";
+}
+
+void CwndBinaryTraceSink(Ptr<BinaryTraceWriter> writer, uint32_t streamId, uint32_t oldval, uint32_t newval) {
+    writer->append(streamId, newval);
 }
 
-void SetupTracing(Ptr<Node> node) {
+void RTTBinaryTrace(Ptr<BinaryTraceWriter> writer, uint32_t streamId, Time oldRtt, Time newRtt) {
+    writer->append(streamId, newRtt.GetDouble());
+}
+
+void SetupTracing(Ptr<Node> node, Ptr<BinaryTraceWriter> writer) {
     // Get the list of sockets on the specified node
     ObjectMapValue socketList;
     node->GetObject<TcpL4Protocol>()->GetAttribute("SocketList", socketList);
@@ -31,6 +42,15 @@ void SetupTracing(Ptr<Node> node) {
 
         Ptr<TcpSocketBase> socketBase = DynamicCast<TcpSocketBase>(socketList.Get(socketIndex));
 
+        // The binary records are turned into the same files as below by UtilityPython/trace_to_csv.py
+        if (writer != nullptr) {
+            uint32_t cwndStream = writer->addStream("cwnd", node->GetId(), socketIndex);
+            socketBase->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback(&CwndBinaryTraceSink, writer, cwndStream));
+            uint32_t rttStream = writer->addStream("rtt", node->GetId(), socketIndex);
+            socketBase->TraceConnectWithoutContext("RTT", MakeBoundCallback(&RTTBinaryTrace, writer, rttStream));
+            continue;
+        }
+
         // --- CONGESTION WINDOW ---
         std::string CWNDLogName = "scratch/P5-Satellite/out/CongestionWindow_Node" +
                               std::to_string(node->GetId()) + "_Socket" +
@@ -6,6 +6,8 @@
 #include "ns3/internet-module.h"
 #include "ns3/network-module.h"
 
+#include "traceWriter.h"
+
 using namespace ns3;
 
 /**
@@ -17,11 +19,22 @@ using namespace ns3;
  */
 void CwndTraceSink(Ptr<OutputStreamWrapper> logStream, uint32_t oldval, uint32_t newval);
 
+/**
+ * \brief Used as trace sink for recording Congestion Windows with a BinaryTraceWriter
+ * \warning INTERNAL METHOD do not call!
+ * \param writer The writer the records are appended to
+ * \param streamId The stream of the socket, from BinaryTraceWriter::addStream()
+ * \param oldval (from trace source)
+ * \param newval (from trace source)
+ */
+void CwndBinaryTraceSink(Ptr<BinaryTraceWriter> writer, uint32_t streamId, uint32_t oldval, uint32_t newval);
+
 /**
  * \brief A master method for enabling tracing for all the sockets on a node
  * \param node The node which to enable the tracing
+ * \param writer If set, the traces are recorded in binary with this writer instead of written as CSV files
  */
-void SetupTracing(Ptr<Node> node);
+void SetupTracing(Ptr<Node> node, Ptr<BinaryTraceWriter> writer);
 
 /**
  * \brief Given a source and destination node, get the complete path between them
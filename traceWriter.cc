@@ -0,0 +1,69 @@
+#include "traceWriter.h"
+
+#include <chrono>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("P5-Trace-Writer");
+
+BinaryTraceWriter::BinaryTraceWriter(const std::string& pathPrefix, size_t ringCapacity)
+    : ring(ringCapacity),
+      records(pathPrefix + ".bin", std::ios::binary | std::ios::trunc),
+      streams(pathPrefix + ".streams", std::ios::trunc) {
+    if (!this->records.is_open() || !this->streams.is_open()) {
+        NS_LOG_ERROR("Failed to open file: " << pathPrefix << ".bin/.streams");
+    }
+    this->streams << "id,kind,node,socket" << std::endl;
+    this->writer = std::thread(&BinaryTraceWriter::drain, this);
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+    this->close();
+}
+
+uint32_t BinaryTraceWriter::addStream(const std::string& kind, uint32_t nodeId, uint32_t socketIndex) {
+    uint32_t streamId = this->nextStreamId++;
+    // Streams are only added when tracing is set up, so they can be written right away
+    this->streams << streamId << "," << kind << "," << nodeId << "," << socketIndex << std::endl;
+    return streamId;
+}
+
+void BinaryTraceWriter::append(uint32_t streamId, double value) {
+    TraceRecord record = {Simulator::Now().GetSeconds(), value, streamId};
+    if (!this->ring.push(record)) {
+        this->stalls++;
+        do {
+            std::this_thread::yield();
+        } while (!this->ring.push(record));
+    }
+}
+
+void BinaryTraceWriter::close() {
+    if (this->closed) {
+        return;
+    }
+    this->closed = true;
+    this->stopping.store(true, std::memory_order_release);
+    this->writer.join();
+    this->records.close();
+    this->streams.close();
+    if (this->stalls > 0) {
+        NS_LOG_WARN(this->stalls << " trace records had to wait for room in the ring, consider a larger ring");
+    }
+}
+
+void BinaryTraceWriter::drain() {
+    std::vector<TraceRecord> batch(4096);
+    while (true) {
+        // Read the flag before popping, so everything pushed before close() is popped after seeing it
+        bool stop = this->stopping.load(std::memory_order_acquire);
+        size_t count = this->ring.pop(batch.data(), batch.size());
+        if (count > 0) {
+            this->records.write(reinterpret_cast<const char*>(batch.data()), count * sizeof(TraceRecord));
+        } else if (stop) {
+            break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ns3;
+
+#pragma pack(push, 1)
+typedef struct TraceRecord
+{
+    double time;                // simulated seconds
+    double value;
+    uint32_t streamId;          // see BinaryTraceWriter::addStream()
+} TraceRecord;
+#pragma pack(pop)
+
+static_assert(sizeof(TraceRecord) == 20, "TraceRecord is written to disk as is");
+
+/**
+ * Lock-free ring buffer for exactly one producer thread and one consumer thread.
+ * Each side keeps a cached copy of the other side's index, so the shared indexes are only read when the cached one
+ * says the ring is full (producer) or empty (consumer).
+ */
+template <typename T>
+class SpscRing
+{
+    public:
+        // The capacity is rounded up to a power of two
+        explicit SpscRing(size_t capacity) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            this->slots.resize(size);
+            this->mask = size - 1;
+        }
+
+        /**
+         * Producer only. Returns false if the ring is full.
+         */
+        bool push(const T& item) {
+            size_t head = this->head.load(std::memory_order_relaxed);
+            if (head - this->cachedTail == this->slots.size()) {
+                this->cachedTail = this->tail.load(std::memory_order_acquire);
+                if (head - this->cachedTail == this->slots.size()) {
+                    return false;
+                }
+            }
+            this->slots[head & this->mask] = item;
+            this->head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Consumer only. Move up to 'max' items to 'out', returning how many were moved.
+         */
+        size_t pop(T* out, size_t max) {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            if (this->cachedHead == tail) {
+                this->cachedHead = this->head.load(std::memory_order_acquire);
+                if (this->cachedHead == tail) {
+                    return 0;
+                }
+            }
+            size_t count = std::min(max, this->cachedHead - tail);
+            for (size_t n = 0; n < count; n++) {
+                out[n] = this->slots[(tail + n) & this->mask];
+            }
+            this->tail.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+    private:
+        std::vector<T> slots;
+        size_t mask = 0;
+
+        // Both indexes only ever grow, the slot is the index masked by the capacity
+        alignas(64) std::atomic<size_t> head{0};    // next slot to write, owned by the producer
+        alignas(64) size_t cachedTail = 0;          // the producer's copy of 'tail'
+        alignas(64) std::atomic<size_t> tail{0};    // next slot to read, owned by the consumer
+        alignas(64) size_t cachedHead = 0;          // the consumer's copy of 'head'
+};
+
+/**
+ * Trace backend that appends fixed-size binary records instead of formatting and flushing a CSV line per event.
+ * The simulation thread pushes records into an SpscRing, and a background thread drains it into '<prefix>.bin'.
+ * Streams, such as the congestion window of one socket, are listed in '<prefix>.streams' as "id,kind,node,socket".
+ * UtilityPython/trace_to_csv.py turns both files back into the CSV files the plotters read.
+ *
+ * If the writer thread falls behind and the ring fills up, the simulation thread waits for it rather than dropping records.
+ */
+class BinaryTraceWriter : public SimpleRefCount<BinaryTraceWriter>
+{
+    public:
+        explicit BinaryTraceWriter(const std::string& pathPrefix, size_t ringCapacity = 1 << 16);
+        ~BinaryTraceWriter();
+
+        BinaryTraceWriter(const BinaryTraceWriter&) = delete;
+        BinaryTraceWriter& operator=(const BinaryTraceWriter&) = delete;
+
+        /**
+         * Register a stream of records, returning its ID. 'kind' is "cwnd" or "rtt".
+         */
+        uint32_t addStream(const std::string& kind, uint32_t nodeId, uint32_t socketIndex);
+
+        /**
+         * Record 'value' for the stream at the current simulated time.
+         */
+        void append(uint32_t streamId, double value);
+
+        /**
+         * Write out every record still in the ring, and stop the writer thread. Called by the destructor as well.
+         */
+        void close();
+
+    private:
+        SpscRing<TraceRecord> ring;
+        std::ofstream records;
+        std::ofstream streams;
+        uint32_t nextStreamId = 0;
+        // Records the simulation thread had to wait for room in the ring for
+        uint64_t stalls = 0;
+
+        std::thread writer;
+        std::atomic<bool> stopping{false};
+        bool closed = false;
+
+        void drain();
+};
+
+#endif